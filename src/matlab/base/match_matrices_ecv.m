@@ -0,0 +1,73 @@
+%MATCH_MATRICES_ECV Match matrices of an observation to every model
+%
+% [mms] = match_matrices_ecv(om_,tom_,varargin)
+%
+% Computes the match matrices (see MATCH_MATRIX_ECV.M) between the
+% observation tom_ and every model in om_ once so that they can be
+% given to ransac_match_objmodel_ecv ('matchMatrices') in runs that
+% only differ in the RANSAC parameters. The columns of every match
+% matrix are sorted by the match quality and thus the matrix of
+% numOfBestMatches matches serves all runs of the same or smaller
+% numOfBestMatches.
+%
+% Output:
+%  mms  - Cell array of the match matrices (one per model)
+%
+% Input:
+%  om_  - ECV based object models (the database)
+%  tom_ - ECV based object model of the observation
+% <Optional>
+%  numOfBestMatches       - The largest number of matches used
+%                           (def. 10)
+%  useLineColour, lineColourMatchMethod, useLocalDistanceHistograms,
+%  localDistanceHistogramMatchMethod - Passed to match_matrix_ecv
+%  fromObservationToModel - As in ransac_match_objmodel_ecv (def. true)
+%  debugLevel             - Select from [0,1,2]
+%
+% Author(s):
+%    Joni Kamarainen, CoViL in 2011-2012.
+%
+% Project:
+%  -
+%
+% Copyright:
+%
+%   Copyright (C) 2011-2012 by Cognitive Vision Laboratory,
+%   SDU <norbert@mmmi.sdu.dk> and Joni Kamarainen <Joni.Kamarainen@lut.fi>
+%
+% References:
+%  [1] Kamarainen, J.-K., Buch, A.G., Krueger, N., 3D Object Detection
+%      Using Accumulated Early Vision Primitives, submitted.
+%
+% See also MATCH_MATRIX_ECV.M and RANSAC_MATCH_OBJMODEL_ECV.M .
+%
+function [mms] = match_matrices_ecv(om_,tom_,varargin)
+
+% 1. Parse input arguments
+conf = struct(...
+    'numOfBestMatches', 10,...
+    'useLineColour',true,...
+    'lineColourMatchMethod',1,...
+    'useLocalDistanceHistograms',false,...
+    'localDistanceHistogramMatchMethod',nan,...
+    'fromObservationToModel',true,...
+    'debugLevel', 0);
+conf = mvpr_getargs(conf,varargin);
+
+mms = cell(length(om_),1);
+for om_i = 1:length(om_)
+    if (conf.fromObservationToModel)
+        fromObj = tom_;
+        toObj = om_(om_i);
+    else
+        fromObj = om_(om_i);
+        toObj = tom_;
+    end;
+    mms{om_i} = match_matrix_ecv(fromObj, toObj,...
+                                 'useLineColour',conf.useLineColour,...
+                                 'lineColourMatchMethod',conf.lineColourMatchMethod,...
+                                 'useLocalDistanceHistograms',conf.useLocalDistanceHistograms,...
+                                 'localDistanceHistogramMatchMethod',conf.localDistanceHistogramMatchMethod,...
+                                 'numOfBestMatches', conf.numOfBestMatches,...
+                                 'debugLevel',conf.debugLevel);
+end;
@@ -0,0 +1,77 @@
+%POSE_DIST_ECV Distance between an observation and a posed model
+%
+% [mindist minDists minDistInds] = pose_dist_ecv(fromObj_,toObj_,H_,mm_mask_,:)
+%
+% Transforms the toObj_ primitive locations by H_ to the fromObj_
+% coordinates and computes the same distance which
+% ransac_match_objmodel_ecv() uses to rank the hypotheses, i.e. the
+% distance from every fromObj_ primitive to its closest toObj_
+% primitive among its best colour matches (mm_mask_), summarised by
+% the locationDistanceMethod.
+%
+% Output:
+%  mindist     - Summarised distance (smaller is better)
+%  minDists    - Distance of every fromObj_ primitive to its closest
+%                toObj_ primitive
+%  minDistInds - Index of the closest toObj_ primitive
+%
+% Input:
+%  fromObj_ - Object model (observation), see OBJMODEL_ECV.M
+%  toObj_   - Object model (database model)
+%  H_       - Homogeneous transformation from toObj_ to fromObj_
+%  mm_mask_ - Mask as returned by match_matrix_ecv(fromObj_,toObj_)
+% <Optional>
+%  locationDistanceMethod - As in ransac_match_objmodel_ecv() (def. 2)
+%
+% Author(s):
+%    Joni Kamarainen, CoViL in 2011-2012.
+%
+% Project:
+%  -
+%
+% Copyright:
+%
+%   Copyright (C) 2011-2012 by Cognitive Vision Laboratory,
+%   SDU <norbert@mmmi.sdu.dk> and Joni Kamarainen <Joni.Kamarainen@lut.fi>
+%
+% References:
+%  [1] Kamarainen, J.-K., Buch, A.G., Krueger, N., 3D Object Detection
+%      Using Accumulated Early Vision Primitives, submitted.
+%
+% See also RANSAC_MATCH_OBJMODEL_ECV.M and TRACK_OBJMODEL_ECV.M .
+%
+function [mindist minDists minDistInds] = pose_dist_ecv(fromObj_,toObj_,H_,mm_mask_,varargin)
+
+% 1. Parse input arguments
+conf = struct(...
+    'locationDistanceMethod',2);
+conf = mvpr_getargs(conf,varargin);
+
+toObj_fromCoords = mvpr_hnd_trans(toObj_.ecv.line_locations',H_)';
+
+% compute distances from every fromObj point to every toObj point
+dist = (repmat(fromObj_.ecv.line_locations,[1 1 toObj_.ecv.numOfLinePrimitives])-...
+        repmat(shiftdim(toObj_fromCoords',-1), [fromObj_.ecv.numOfLinePrimitives 1 1]));
+dist = squeeze(sum(dist.^2,2));
+
+% mask the best matches for every feature only
+dist(~mm_mask_) = inf;
+[minDists minDistInds] = min(dist,[],2);
+
+% Compute the distance between primitives
+if (conf.locationDistanceMethod == 1) % average
+    mindist = sum(minDists)/fromObj_.ecv.numOfLinePrimitives;
+elseif (conf.locationDistanceMethod == 2) % median (best50%)
+    mindist = median(minDists);
+else
+    sorted_dists = sort(minDists,1,'ascend');
+    if (conf.locationDistanceMethod == 3) % best25%
+        mindist = sorted_dists(round(0.25*length(sorted_dists)));
+    elseif (conf.locationDistanceMethod == 4) % best75%
+        mindist = sorted_dists(round(0.75*length(sorted_dists)));
+    elseif (conf.locationDistanceMethod == 5) % best90%
+        mindist = sorted_dists(round(0.90*length(sorted_dists)));
+    else
+        error('Unknown locationDistanceMethod!');
+    end;
+end;
@@ -0,0 +1,60 @@
+%POSE_PRIOR_ECV Spatial pose prior of the matching hypotheses
+%
+% [ok] = pose_prior_ecv(H_)
+%
+% Checks whether the transformation H_ (model to observation) is
+% plausible for the rendered KIT views, i.e. the in-plane rotation
+% is at most 20 degrees and the translation is not huge. Used by
+% ransac_match_objmodel_ecv() and track_objmodel_ecv() when
+% 'posePrior' is set. Works only in 3D.
+%
+% Output:
+%  ok - true if H_ passes the prior (false for NaN or reflections)
+%
+% Input:
+%  H_ - Homogeneous 4x4 transformation
+%
+% Author(s):
+%    Joni Kamarainen, CoViL in 2011-2012.
+%
+% Project:
+%  -
+%
+% Copyright:
+%
+%   Copyright (C) 2011-2012 by Cognitive Vision Laboratory,
+%   SDU <norbert@mmmi.sdu.dk> and Joni Kamarainen <Joni.Kamarainen@lut.fi>
+%
+% See also RANSAC_MATCH_OBJMODEL_ECV.M and TRACK_OBJMODEL_ECV.M .
+%
+function [ok] = pose_prior_ecv(H_)
+
+ok = false;
+if (sum(isnan(H_(:))))
+    return;
+end;
+
+H_translation = sqrt(H_(1:3,4)'*H_(1:3,4));
+[U_H S_H V_H] = svd(H_(1:3,1:3));
+R_H = U_H*V_H';
+detR_H = det(R_H);
+if abs(detR_H-1)<10^(-5)%det(R)==1
+    if R_H(1,1)>0
+        H_angle = asind(-R_H(1,2));
+    else
+        H_angle = 2*90*sign(asind(-R_H(1,2))) - asind(-R_H(1,2));
+    end
+else
+    warning('det not equal to 1');
+    return;
+end
+%if (H_scale < 0.5 || H_scale > 2)
+%  return;
+%end;
+if (abs(H_angle) > 20)
+    return;
+end;
+if (H_translation > 9.5*10^8)
+    return;
+end;
+ok = true;
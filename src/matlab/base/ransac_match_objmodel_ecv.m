@@ -36,6 +36,12 @@
 %                           inliers (Def. false)
 %  reEstBest              - Proportion of the best points used in
 %                           re-estimation (Def. 0.5 ~median)
+%  matchMatrices          - Precomputed match matrices of every model
+%                           (see MATCH_MATRICES_ECV.M) computed using
+%                           the same colour settings and direction and
+%                           at least numOfBestMatches matches, the
+%                           first numOfBestMatches are used (Def. {}
+%                           computed here)
 %  debugLevel             - Select from [0,1,2]
 %
 % Author(s):
@@ -55,7 +61,8 @@
 %  [2] Hartley, R., and Zisserman, A., Multiple View Geometry in Computer
 %      Vision, 2003.
 %
-% See also OBJMODEL_ECV.M and MATCH_MATRIC_ECV.M .
+% See also OBJMODEL_ECV.M, MATCH_MATRIC_ECV.M, MATCH_MATRICES_ECV.M and
+% POSE_DIST_ECV.M .
 %
 function [bestObjNum bestDist bestH] = ransac_match_objmodel_ecv(om_, tom_,varargin)
 
@@ -74,6 +81,7 @@ conf = struct(...
     'reEstimate',false,...
     'reEstBest',0.5,...
     'posePrior', false,...
+    'matchMatrices', {{}},...
     'debugLevel', 0);
 conf = mvpr_getargs(conf,varargin);
 
@@ -93,13 +101,19 @@ for om_i = 1:length(om_) % test every model
         toObj = tom_;
     end;
 
-    [mm mm_mask] = match_matrix_ecv(fromObj, toObj,...
-                                    'useLineColour',conf.useLineColour,...
-                                    'lineColourMatchMethod',conf.lineColourMatchMethod,...
-                                    'useLocalDistanceHistograms',conf.useLocalDistanceHistograms,...
-                                    'localDistanceHistogramMatchMethod',conf.localDistanceHistogramMatchMethod,...
-                                    'numOfBestMatches', conf.numOfBestMatches,...
-                                    'debugLevel',conf.debugLevel);
+    if (~isempty(conf.matchMatrices))
+        [mm mm_mask] = cached_match_matrix(conf.matchMatrices{om_i},...
+                                           conf.numOfBestMatches,...
+                                           toObj.ecv.numOfLinePrimitives);
+    else
+        [mm mm_mask] = match_matrix_ecv(fromObj, toObj,...
+                                        'useLineColour',conf.useLineColour,...
+                                        'lineColourMatchMethod',conf.lineColourMatchMethod,...
+                                        'useLocalDistanceHistograms',conf.useLocalDistanceHistograms,...
+                                        'localDistanceHistogramMatchMethod',conf.localDistanceHistogramMatchMethod,...
+                                        'numOfBestMatches', conf.numOfBestMatches,...
+                                        'debugLevel',conf.debugLevel);
+    end;
    
     
     % generate a set of random indences for the model and the image
@@ -119,66 +133,13 @@ for om_i = 1:length(om_) % test every model
                 [fromObj.ecv.line_locations(from_randinds(ii,1),:);...
                  fromObj.ecv.line_locations(from_randinds(ii,2),:);...
                  fromObj.ecv.line_locations(from_randinds(ii,3),:)]',conf.UmeyamaScale);
-        if conf.posePrior
-          % applying spatial prior
-          if (sum(isnan(H)))
-            continue;
-          end;
-          
-          % Works only in 3D -
-          H_translation = sqrt(H(1:3,4)'*H(1:3,4));
-          A = H(1:2,1:2);
-          [U_H S_H V_H] = svd(H(1:3,1:3));
-          H_scale = S_H(1,1);
-          R_H = U_H*V_H';
-          detR_H = det(R_H);
-          if abs(detR_H-1)<10^(-5)%det(R)==1
-            if R_H(1,1)>0
-              H_angle = asind(-R_H(1,2));
-            else
-              H_angle = 2*90*sign(asind(-R_H(1,2))) - asind(-R_H(1,2));
-            end
-          else
-            warning('det not equal to 1');
-          end
-          %if (ii > 1) % at least one will be taken?!? (maybe incorrect)
-          %if (H_scale < 0.5 || H_scale > 2)
-          %  continue;
-          %end;
-          if (abs(H_angle) > 20)
-            continue;
-          end;
-          if (H_translation > 9.5*10^8)
-            continue;
-          end;
-          %end;
+        if (conf.posePrior && ~pose_prior_ecv(H))
+            continue; % applying spatial prior
         end;
 
-        toObj_fromCoords = mvpr_hnd_trans(toObj.ecv.line_locations',H)';
-        
-        % compute distances from every fromObj point to every toObj point
-        dist = (repmat(fromObj.ecv.line_locations,[1 1 toObj.ecv.numOfLinePrimitives])-...
-                repmat(shiftdim(toObj_fromCoords',-1), [fromObj.ecv.numOfLinePrimitives 1 1]));
-        dist = squeeze(sum(dist.^2,2));
-
-        % mask the best matches for every feature only
-        dist(~mm_mask) = inf; 
-        
-        % Compute the distance between primitives
-        if (conf.locationDistanceMethod == 1) % average
-            [mindist] = sum(min(dist,[],2))/fromObj.ecv.numOfLinePrimitives;
-        elseif (conf.locationDistanceMethod == 2) % median (best50%)
-            [mindist] = median(min(dist,[],2));
-        elseif (conf.locationDistanceMethod == 3) % best25%
-            sorted_dists = sort(min(dist,[],2),1,'ascend');
-            mindist = sorted_dists(round(0.25*length(sorted_dists)));
-        elseif (conf.locationDistanceMethod == 4) % best75%
-            sorted_dists = sort(min(dist,[],2),1,'ascend');
-            mindist = sorted_dists(round(0.75*length(sorted_dists)));
-        elseif (conf.locationDistanceMethod == 5) % best90%
-            sorted_dists = sort(min(dist,[],2),1,'ascend');
-            mindist = sorted_dists(round(0.90*length(sorted_dists)));
-        end;
+        % Distance between the observation and the posed model
+        mindist = pose_dist_ecv(fromObj,toObj,H,mm_mask,...
+                                'locationDistanceMethod',conf.locationDistanceMethod);
 
         % update if better
         betterInds = find(mindist < bestDist);
@@ -193,6 +154,7 @@ for om_i = 1:length(om_) % test every model
             %% DEBUG 2 START %%%
             if (conf.debugLevel > 1 && betterInds(1) == 1)
                 H
+                toObj_fromCoords = mvpr_hnd_trans(toObj.ecv.line_locations',H)';
                 clf;
                 hold on;
                 if (conf.fromObservationToModel) 
@@ -226,27 +188,26 @@ if (conf.reEstimate)
     if (conf.fromObservationToModel)
         for candInd = 1:conf.numOfBestHypotheses
             toObj = om_(bestObjNum(candInd));
-            toObj_fromCoords = mvpr_hnd_trans(toObj.ecv.line_locations',bestH(:,:,candInd))';
 
-            [mm mm_mask] = match_matrix_ecv(fromObj, toObj,...
-                                            'useLineColour',conf.useLineColour,...
-                                            'lineColourMatchMethod',conf.lineColourMatchMethod,...
-                                            'useLocalDistanceHistograms',conf.useLocalDistanceHistograms,...
-                                            'localDistanceHistogramMatchMethod',conf.localDistanceHistogramMatchMethod,...
-                                            'numOfBestMatches', conf.numOfBestMatches,...
-                                            'debugLevel',conf.debugLevel);
+            if (~isempty(conf.matchMatrices))
+                [mm mm_mask] = cached_match_matrix(conf.matchMatrices{bestObjNum(candInd)},...
+                                                   conf.numOfBestMatches,...
+                                                   toObj.ecv.numOfLinePrimitives);
+            else
+                [mm mm_mask] = match_matrix_ecv(fromObj, toObj,...
+                                                'useLineColour',conf.useLineColour,...
+                                                'lineColourMatchMethod',conf.lineColourMatchMethod,...
+                                                'useLocalDistanceHistograms',conf.useLocalDistanceHistograms,...
+                                                'localDistanceHistogramMatchMethod',conf.localDistanceHistogramMatchMethod,...
+                                                'numOfBestMatches', conf.numOfBestMatches,...
+                                                'debugLevel',conf.debugLevel);
+            end;
 
-            % compute distances from every fromObj point to every toObj point
-            dist = (repmat(fromObj.ecv.line_locations,[1 1 toObj.ecv.numOfLinePrimitives])-...
-                    repmat(shiftdim(toObj_fromCoords',-1), [fromObj.ecv.numOfLinePrimitives 1 1]));
-            dist = squeeze(sum(dist.^2,2));
-            
-            % mask the best matches for every feature only
-            dist(~mm_mask) = inf; 
-        
             % sort the distances to select only the best ones as
             % "inliers"
-            [minDists minDistInds] = min(dist,[],2);
+            [mindist minDists minDistInds] = ...
+                pose_dist_ecv(fromObj,toObj,bestH(:,:,candInd),mm_mask,...
+                              'locationDistanceMethod',conf.locationDistanceMethod);
             [sorted_dists sorted_dists_inds ] = sort(minDists,1,'ascend');
             
             lastInd = round(conf.reEstBest*length(minDists));
@@ -257,27 +218,8 @@ if (conf.reEstimate)
             H = mvpr_hnd_corresp_umeyama(to_inlier_points', ...
                                          from_inlier_points', conf.UmeyamaScale);
         
-            toObj_fromCoords = mvpr_hnd_trans(toObj.ecv.line_locations',H)';
-            % compute distances from every fromObj point to every toObj point
-            dist = (repmat(fromObj.ecv.line_locations,[1 1 toObj.ecv.numOfLinePrimitives])-...
-                    repmat(shiftdim(toObj_fromCoords',-1), [fromObj.ecv.numOfLinePrimitives 1 1]));
-            dist = squeeze(sum(dist.^2,2));
-            
-            % mask the best matches for every feature only
-            dist(~mm_mask) = inf; 
-            
-            % Compute the distance between primitives
-            if (conf.locationDistanceMethod == 1) % average
-                [mindist] = sum(min(dist,[],2))/fromObj.ecv.numOfLinePrimitives;
-            elseif (conf.locationDistanceMethod == 2) % median (best50%)
-                [mindist] = median(min(dist,[],2));
-            elseif (conf.locationDistanceMethod == 3) % best25%
-                sorted_dists = sort(min(dist,[],2),1,'ascend');
-                mindist = sorted_dists(round(0.25*length(sorted_dists)));
-            elseif (conf.locationDistanceMethod == 4) % best75%
-                sorted_dists = sort(min(dist,[],2),1,'ascend');
-                mindist = sorted_dists(round(0.75*length(sorted_dists)));
-            end;
+            mindist = pose_dist_ecv(fromObj,toObj,H,mm_mask,...
+                                    'locationDistanceMethod',conf.locationDistanceMethod);
             
             % Update H and update distances
             bestDist(candInd) = mindist;
@@ -295,6 +237,7 @@ if (conf.reEstimate)
         %% DEBUG 2 START %%%
         if (conf.debugLevel > 1)
             H
+            toObj_fromCoords = mvpr_hnd_trans(toObj.ecv.line_locations',H)';
             clf;
             hold on;
             if (conf.fromObservationToModel) 
@@ -322,4 +265,16 @@ if (conf.reEstimate)
     else
         warning('Re-estimation to this direction not implemented!');
     end;
-end;
\ No newline at end of file
+end;
+
+%%% INTERNALS
+% Match matrix and mask of the numOfBestMatches_ first matches of a
+% precomputed match matrix (columns sorted by the match quality as
+% in match_matrix_ecv)
+function [mm,mm_mask] = cached_match_matrix(mmAll_,numOfBestMatches_,numOfToPrims_)
+
+mm = mmAll_(:,1:min([size(mmAll_,2) numOfBestMatches_]));
+mm_mask = zeros(size(mm,1),numOfToPrims_);
+for ii = 1:size(mm,1)
+    mm_mask(ii,mm(ii,:)) = 1;
+end;
@@ -0,0 +1,88 @@
+%RANSAC_MATCH_SHARDED_ECV Scatter-gather version of ransac_match_objmodel_ecv
+%
+% [bestObjNum bestDist bestH] = ransac_match_sharded_ecv(shards_,tom_,:)
+%
+% The object database is partitioned to several worker processes
+% (see SHARD_WORKER_ECV.M) and this coordinator function broadcasts
+% the observation to all of them, gathers their numOfBestHypotheses
+% best lists and merges them to the global ranking. Since every
+% global top hypothesis is among the top hypotheses of its own shard,
+% the merged list is the one ransac_match_objmodel_ecv() would
+% produce with the whole database (up to the random samples). With
+% 'reEstimate' the workers re-estimate their own best candidates
+% before the merge, i.e. the re-estimated candidate set is a superset
+% of the global one.
+%
+% Output:
+%  bestObjNum - Global database numbers of the best hypotheses
+%  bestDist   - Their distances (ascending)
+%  bestH      - Their transformations
+%
+% Input:
+%  shards_ - As returned by shard_connect_ecv()
+%  tom_    - Observation object model (see OBJMODEL_ECV.M)
+% <Optional>
+%  numOfBestHypotheses - How many best returned (def. 10), must
+%                        not exceed the workers' value
+%  debugLevel          - Select from [0,1,2]
+%
+% Author(s):
+%    Joni Kamarainen, CoViL in 2011-2012.
+%
+% Project:
+%  -
+%
+% Copyright:
+%
+%   Copyright (C) 2011-2012 by Cognitive Vision Laboratory,
+%   SDU <norbert@mmmi.sdu.dk> and Joni Kamarainen <Joni.Kamarainen@lut.fi>
+%
+% See also RANSAC_MATCH_OBJMODEL_ECV.M, SHARD_WORKER_ECV.M and
+% SHARD_CONNECT_ECV.M .
+%
+function [bestObjNum bestDist bestH] = ransac_match_sharded_ecv(shards_, tom_, varargin)
+
+% 1. Parse input arguments
+conf = struct(...
+    'numOfBestHypotheses', 10,...
+    'debugLevel', 0);
+conf = mvpr_getargs(conf,varargin);
+
+% Scatter (all workers start matching before any result is read)
+msg = [1 tom_.ecv.numOfLinePrimitives size(tom_.ecv.line_locations,2)...
+       tom_.ecv.line_locations(:)' tom_.ecv.line_leftcolour(:)'...
+       tom_.ecv.line_middlecolour(:)' tom_.ecv.line_rightcolour(:)'];
+for si = 1:length(shards_)
+    shards_(si).out.writeObject(msg);
+    shards_(si).out.flush();
+    shards_(si).out.reset();
+end;
+
+% Gather
+allObjNum = [];
+allDist = [];
+allH = [];
+for si = 1:length(shards_)
+    try
+        resp = double(shards_(si).in.readObject());
+    catch err
+        error('No response from the shard worker at localhost:%d: %s',...
+              shards_(si).port,err.message);
+    end;
+    numOfHyp = resp(1);
+    hSize = resp(2);
+    allObjNum = [allObjNum; resp(3:2+numOfHyp)];
+    allDist = [allDist; resp(3+numOfHyp:2+2*numOfHyp)];
+    allH = cat(3,allH,reshape(resp(3+2*numOfHyp:end),hSize,hSize,numOfHyp));
+    if (conf.debugLevel > 0)
+        fprintf('Shard %d (port %d): best %d dist %f\n',si,shards_(si).port,...
+                resp(3),resp(3+numOfHyp));
+    end;
+end;
+
+% Merge (stable sort keeps the shard order for equal distances)
+[sortDist sortInds] = sort(allDist,1,'ascend');
+sortInds = sortInds(1:min([conf.numOfBestHypotheses length(sortInds)]));
+bestObjNum = allObjNum(sortInds);
+bestDist = allDist(sortInds);
+bestH = allH(:,:,sortInds);
@@ -0,0 +1,63 @@
+%SHARD_CONNECT_ECV Connect to the shard workers
+%
+% [shards] = shard_connect_ecv(ports_,:)
+%
+% Opens a local socket connection to every shard worker (see
+% SHARD_WORKER_ECV.M) listening to localhost:ports_(i). Since the
+% workers may still be loading their models, the connection is
+% retried until the timeout. Reading a worker response fails after
+% readTimeout seconds (e.g. the worker died) instead of blocking.
+%
+% Output:
+%  shards - Connection structure array (socket, in, out) for
+%           ransac_match_sharded_ecv() and shard_disconnect_ecv()
+%
+% Input:
+%  ports_ - Worker ports
+% <Optional>
+%  timeout     - Seconds to wait for every worker (def. 600)
+%  readTimeout - Seconds to wait for a response (def. 600)
+%
+% Author(s):
+%    Joni Kamarainen, CoViL in 2011-2012.
+%
+% Project:
+%  -
+%
+% Copyright:
+%
+%   Copyright (C) 2011-2012 by Cognitive Vision Laboratory,
+%   SDU <norbert@mmmi.sdu.dk> and Joni Kamarainen <Joni.Kamarainen@lut.fi>
+%
+% See also SHARD_WORKER_ECV.M and SHARD_DISCONNECT_ECV.M .
+%
+function [shards] = shard_connect_ecv(ports_,varargin)
+
+% 1. Parse input arguments
+conf = struct(...
+    'timeout', 600,...
+    'readTimeout', 600);
+conf = mvpr_getargs(conf,varargin);
+
+for si = 1:length(ports_)
+    startTime = tic;
+    while (true)
+        try
+            sock = java.net.Socket('localhost', ports_(si));
+            break;
+        catch err
+            if (toc(startTime) > conf.timeout)
+                error('Cannot connect to the shard worker at localhost:%d',ports_(si));
+            end;
+            pause(1);
+        end;
+    end;
+    sock.setTcpNoDelay(true);
+    sock.setSoTimeout(conf.readTimeout*1000);
+    shards(si).port = ports_(si);
+    shards(si).socket = sock;
+    % Output stream first (the stream header) or both ends block
+    shards(si).out = java.io.ObjectOutputStream(java.io.BufferedOutputStream(sock.getOutputStream()));
+    shards(si).out.flush();
+    shards(si).in = java.io.ObjectInputStream(java.io.BufferedInputStream(sock.getInputStream()));
+end;
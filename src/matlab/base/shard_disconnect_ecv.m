@@ -0,0 +1,39 @@
+%SHARD_DISCONNECT_ECV Disconnect from the shard workers
+%
+% shard_disconnect_ecv(shards_,:)
+%
+% Closes the connections opened by shard_connect_ecv() and
+% optionally tells the workers to quit.
+%
+% Input:
+%  shards_ - As returned by shard_connect_ecv()
+% <Optional>
+%  quitWorkers - Send the quit message to the workers (def. false)
+%
+% Author(s):
+%    Joni Kamarainen, CoViL in 2011-2012.
+%
+% Project:
+%  -
+%
+% Copyright:
+%
+%   Copyright (C) 2011-2012 by Cognitive Vision Laboratory,
+%   SDU <norbert@mmmi.sdu.dk> and Joni Kamarainen <Joni.Kamarainen@lut.fi>
+%
+% See also SHARD_CONNECT_ECV.M .
+%
+function shard_disconnect_ecv(shards_,varargin)
+
+% 1. Parse input arguments
+conf = struct(...
+    'quitWorkers', false);
+conf = mvpr_getargs(conf,varargin);
+
+for si = 1:length(shards_)
+    if (conf.quitWorkers)
+        shards_(si).out.writeObject([0 0]);
+        shards_(si).out.flush();
+    end;
+    shards_(si).socket.close();
+end;
@@ -0,0 +1,115 @@
+%SHARD_WORKER_ECV Serve ransac_match_objmodel_ecv() for one database shard
+%
+% shard_worker_ecv(om_,objNums_,port_,:)
+%
+% Worker of the sharded (scatter-gather) recognition. The worker
+% holds only a part (shard) of the object database and listens to a
+% local socket (localhost:port_). For every observation sent by the
+% coordinator (ransac_match_sharded_ecv()) it runs
+% ransac_match_objmodel_ecv() against its own models and returns the
+% numOfBestHypotheses best hypotheses with the object numbers mapped
+% to the global database numbering (objNums_). The function returns
+% when the coordinator sends the quit message. A coordinator closing
+% the connection (EOF or socket error) is waited for again, any other
+% error closes the worker and is rethrown.
+%
+% Messages are double vectors written by java.io.ObjectOutputStream:
+%
+%  coordinator -> worker:
+%   [0 0]                                   quit
+%   [1 N D locations(:)' leftcolour(:)' middlecolour(:)' rightcolour(:)']
+%                                           match (N primitives in D dims)
+%  worker -> coordinator:
+%   [K S objNum(1:K)' dist(1:K)' H(:)']     K best hypotheses, H is SxSxK
+%
+% Input:
+%  om_      - Object models of this shard (see OBJMODEL_ECV.M)
+%  objNums_ - Global database numbers of om_
+%  port_    - Local TCP port to listen
+% <Optional>
+%  ransacArgs - Cell array of arguments passed to
+%               ransac_match_objmodel_ecv() (def. {})
+%  debugLevel - Select from [0,1,2]
+%
+% Author(s):
+%    Joni Kamarainen, CoViL in 2011-2012.
+%
+% Project:
+%  -
+%
+% Copyright:
+%
+%   Copyright (C) 2011-2012 by Cognitive Vision Laboratory,
+%   SDU <norbert@mmmi.sdu.dk> and Joni Kamarainen <Joni.Kamarainen@lut.fi>
+%
+% See also RANSAC_MATCH_SHARDED_ECV.M and SHARD_CONNECT_ECV.M .
+%
+function shard_worker_ecv(om_, objNums_, port_, varargin)
+
+% 1. Parse input arguments
+conf = struct(...
+    'ransacArgs', {{}},...
+    'debugLevel', 0);
+conf = mvpr_getargs(conf,varargin);
+
+server = java.net.ServerSocket(port_, 1, java.net.InetAddress.getByName('localhost'));
+fprintf('Shard worker of %d models listening to localhost:%d\n',length(om_),port_);
+quitWorker = false;
+while (~quitWorker)
+    sock = server.accept();
+    % Output stream first (the stream header), see shard_connect_ecv
+    out = java.io.ObjectOutputStream(java.io.BufferedOutputStream(sock.getOutputStream()));
+    out.flush();
+    in = java.io.ObjectInputStream(java.io.BufferedInputStream(sock.getInputStream()));
+    if (conf.debugLevel > 0)
+        fprintf('Coordinator connected\n');
+    end;
+    try
+        while (true)
+            msg = double(in.readObject());
+            if (msg(1) == 0)
+                quitWorker = true;
+                break;
+            end;
+
+            % Observation model
+            numOfPrims = msg(2);
+            dim = msg(3);
+            blockLen = numOfPrims*dim;
+            tom.ecv.numOfLinePrimitives = numOfPrims;
+            tom.ecv.is2D = (dim == 2);
+            tom.ecv.line_locations = reshape(msg(4:3+blockLen),numOfPrims,dim);
+            tom.ecv.line_leftcolour = reshape(msg(4+blockLen:3+blockLen+3*numOfPrims),numOfPrims,3);
+            tom.ecv.line_middlecolour = reshape(msg(4+blockLen+3*numOfPrims:3+blockLen+6*numOfPrims),numOfPrims,3);
+            tom.ecv.line_rightcolour = reshape(msg(4+blockLen+6*numOfPrims:3+blockLen+9*numOfPrims),numOfPrims,3);
+            tom.objName = 'observation';
+
+            [bestObjNum bestDist bestH] = ransac_match_objmodel_ecv(om_,tom,conf.ransacArgs{:});
+            globalObjNum = nan(size(bestObjNum));
+            valid = ~isnan(bestObjNum);
+            globalObjNum(valid) = objNums_(bestObjNum(valid));
+
+            resp = [length(bestObjNum) size(bestH,1) globalObjNum(:)' bestDist(:)' bestH(:)'];
+            out.writeObject(resp);
+            out.flush();
+            out.reset(); % do not keep references to the sent arrays
+        end;
+    catch err
+        if (isempty(strfind(err.message,'java.io.EOFException')) && ...
+            isempty(strfind(err.message,'java.net.SocketException')))
+            % Matching failed - the coordinator gets EOF instead of
+            % waiting for the response
+            fprintf('Shard worker at localhost:%d failed: %s\n',port_,err.message);
+            sock.close();
+            server.close();
+            rethrow(err);
+        end;
+        % Coordinator disconnected - wait for the next one
+        if (conf.debugLevel > 0)
+            fprintf('Coordinator disconnected: %s\n',err.message);
+        end;
+    end;
+    sock.close();
+end;
+server.close();
+fprintf('Shard worker at localhost:%d quit\n',port_);
@@ -0,0 +1,242 @@
+%TRACK_OBJMODEL_ECV Track the object and its pose in an image sequence
+%
+% [bestObjNum bestDist bestH tracked] = track_objmodel_ecv(om_,tom_,prevObjNum_,prevH_,refDist_,:)
+%
+% Sequence mode version of ransac_match_objmodel_ecv(). Consecutive
+% frames (e.g. the elevation/azimuth sweeps of render_stereo_pair
+% view mode 2) show the same object from nearby viewpoints and
+% therefore the previous frame's best object and pose are used as the
+% starting point instead of running RANSAC against the whole database:
+%
+%  1. Only the previous best model is matched (match_matrix_ecv).
+%  2. A local neighbourhood of hypotheses around the previous pose
+%     (small random rotations around the object centre and small
+%     translations) and a few RANSAC samples of the previous model
+%     are evaluated.
+%  3. The best hypothesis is refined by a few inlier re-estimation
+%     steps (as 'reEstimate' in ransac_match_objmodel_ecv()).
+%
+% If the resulting distance degrades more than degradeFactor times
+% the reference distance refDist_ (or there is no previous frame,
+% prevObjNum_ is NaN), the full ransac_match_objmodel_ecv() search
+% is run instead. The reference is the distance of the last full
+% search, not the previous tracked frame, so that the allowed
+% distance cannot grow frame by frame. Only the observation to model
+% direction is supported. With 'posePrior' only the hypotheses
+% passing pose_prior_ecv() are considered.
+%
+% Output:
+%  bestObjNum - As in ransac_match_objmodel_ecv(), if tracked only the
+%               first hypothesis is valid (the rest are NaN/Inf)
+%  bestDist   - -"-
+%  bestH      - -"-
+%  tracked    - true if tracked, false if the full search was run
+%
+% Input:
+%  om_         - Database object models
+%  tom_        - Observation object model
+%  prevObjNum_ - Best object of the previous frame (NaN if none)
+%  prevH_      - Best pose of the previous frame
+%  refDist_    - Best distance of the last full search
+% <Optional>
+%  localIters       - Num. of random local hypotheses (def. 100)
+%  localRandIters   - Num. of RANSAC iters against the previous
+%                     model (def. 50)
+%  localRotation    - Max. rotation of the local hypotheses in
+%                     degrees (def. 5)
+%  localTranslation - Max. translation of the local hypotheses in
+%                     primitive coordinate units (def. 10)
+%  refineIters      - Max. num. of re-estimation steps (def. 3)
+%  reEstBest        - Proportion of the best points used in
+%                     re-estimation (Def. 0.5 ~median)
+%  degradeFactor    - Fall back to the full search if the distance
+%                     is more than degradeFactor times refDist_
+%                     (def. 1.5)
+%  numOfBestHypotheses, randIters, useLineColour, lineColourMatchMethod,
+%  numOfBestMatches, locationDistanceMethod, UmeyamaScale, reEstimate,
+%  posePrior - As in ransac_match_objmodel_ecv()
+%  debugLevel       - Select from [0,1,2]
+%
+% Author(s):
+%    Joni Kamarainen, CoViL in 2011-2012.
+%
+% Project:
+%  -
+%
+% Copyright:
+%
+%   Copyright (C) 2011-2012 by Cognitive Vision Laboratory,
+%   SDU <norbert@mmmi.sdu.dk> and Joni Kamarainen <Joni.Kamarainen@lut.fi>
+%
+% References:
+%  [1] Kamarainen, J.-K., Buch, A.G., Krueger, N., 3D Object Detection
+%      Using Accumulated Early Vision Primitives, submitted.
+%
+% See also RANSAC_MATCH_OBJMODEL_ECV.M, POSE_DIST_ECV.M and POSE_PRIOR_ECV.M .
+%
+function [bestObjNum bestDist bestH tracked] = track_objmodel_ecv(om_, tom_, prevObjNum_, prevH_, refDist_, varargin)
+
+% 1. Parse input arguments
+conf = struct(...
+    'localIters', 100,...
+    'localRandIters', 50,...
+    'localRotation', 5,...
+    'localTranslation', 10,...
+    'refineIters', 3,...
+    'reEstBest', 0.5,...
+    'degradeFactor', 1.5,...
+    'numOfBestHypotheses', 10,...
+    'randIters', 1000,...
+    'useLineColour',true,...
+    'lineColourMatchMethod',1,...
+    'numOfBestMatches', 10,...
+    'locationDistanceMethod',2,...
+    'UmeyamaScale',1,...
+    'reEstimate',false,...
+    'posePrior', false,...
+    'debugLevel', 0);
+conf = mvpr_getargs(conf,varargin);
+
+tracked = false;
+if (~isnan(prevObjNum_))
+    fromObj = tom_;
+    toObj = om_(prevObjNum_);
+    dim = size(prevH_,1)-1;
+
+    [mm mm_mask] = match_matrix_ecv(fromObj, toObj,...
+                                    'useLineColour',conf.useLineColour,...
+                                    'lineColourMatchMethod',conf.lineColourMatchMethod,...
+                                    'numOfBestMatches', conf.numOfBestMatches,...
+                                    'debugLevel',conf.debugLevel);
+
+    % The previous pose itself
+    trackH = prevH_;
+    trackDist = pose_dist_ecv(fromObj,toObj,trackH,mm_mask,...
+                              'locationDistanceMethod',conf.locationDistanceMethod);
+    if (conf.posePrior && ~pose_prior_ecv(trackH))
+        trackDist = inf;
+    end;
+
+    % Local neighbourhood around the object centre (observation coords)
+    objCentre = mean(mvpr_hnd_trans(toObj.ecv.line_locations',prevH_),2);
+    for ii = 1:conf.localIters
+        H = local_perturbation(objCentre,dim,conf.localRotation,...
+                               conf.localTranslation)*prevH_;
+        if (conf.posePrior && ~pose_prior_ecv(H))
+            continue; % applying spatial prior
+        end;
+        mindist = pose_dist_ecv(fromObj,toObj,H,mm_mask,...
+                                'locationDistanceMethod',conf.locationDistanceMethod);
+        if (mindist < trackDist)
+            trackDist = mindist;
+            trackH = H;
+        end;
+    end;
+
+    % A few RANSAC iterations against the previous model only
+    from_randinds = ceil((size(mm,1))*rand(conf.localRandIters,3));
+    to_randinds = ceil((size(mm,2))*rand(conf.localRandIters,3));
+    for ii = 1:conf.localRandIters
+        H = ...
+            mvpr_hnd_corresp_umeyama(...
+                [toObj.ecv.line_locations(mm(from_randinds(ii,1),to_randinds(ii,1)),:);...
+                 toObj.ecv.line_locations(mm(from_randinds(ii,2),to_randinds(ii,2)),:);...
+                 toObj.ecv.line_locations(mm(from_randinds(ii,3),to_randinds(ii,3)),:)]',...
+                [fromObj.ecv.line_locations(from_randinds(ii,1),:);...
+                 fromObj.ecv.line_locations(from_randinds(ii,2),:);...
+                 fromObj.ecv.line_locations(from_randinds(ii,3),:)]',conf.UmeyamaScale);
+        if (sum(isnan(H(:))))
+            continue;
+        end;
+        if (conf.posePrior && ~pose_prior_ecv(H))
+            continue; % applying spatial prior
+        end;
+        mindist = pose_dist_ecv(fromObj,toObj,H,mm_mask,...
+                                'locationDistanceMethod',conf.locationDistanceMethod);
+        if (mindist < trackDist)
+            trackDist = mindist;
+            trackH = H;
+        end;
+    end;
+
+    % Refine by the best inliers until no improvement
+    for ri = 1:conf.refineIters
+        if (isinf(trackDist))
+            break; % no hypothesis passed the prior
+        end;
+        [mindist minDists minDistInds] = ...
+            pose_dist_ecv(fromObj,toObj,trackH,mm_mask,...
+                          'locationDistanceMethod',conf.locationDistanceMethod);
+        [sorted_dists sorted_dists_inds] = sort(minDists,1,'ascend');
+        lastInd = round(conf.reEstBest*length(minDists));
+        from_inlier_points = fromObj.ecv.line_locations(sorted_dists_inds(1:lastInd),:);
+        to_inlier_points = toObj.ecv.line_locations(minDistInds(sorted_dists_inds(1:lastInd)),:);
+        H = mvpr_hnd_corresp_umeyama(to_inlier_points', ...
+                                     from_inlier_points', conf.UmeyamaScale);
+        if (conf.posePrior && ~pose_prior_ecv(H))
+            break;
+        end;
+        mindist = pose_dist_ecv(fromObj,toObj,H,mm_mask,...
+                                'locationDistanceMethod',conf.locationDistanceMethod);
+        if (mindist < trackDist)
+            trackDist = mindist;
+            trackH = H;
+        else
+            break;
+        end;
+    end;
+
+    if (trackDist <= conf.degradeFactor*refDist_)
+        tracked = true;
+        bestObjNum = nan(conf.numOfBestHypotheses,1);
+        bestObjNum(1) = prevObjNum_;
+        bestDist = inf(conf.numOfBestHypotheses,1);
+        bestDist(1) = trackDist;
+        bestH = repmat(eye(dim+1),[1 1 conf.numOfBestHypotheses]);
+        bestH(:,:,1) = trackH;
+    end;
+    if (conf.debugLevel > 0)
+        fprintf('\n Tracking %s: dist %f (full search %f) => %s\n',toObj.objName,...
+                trackDist,refDist_,tracked_str(tracked));
+    end;
+end;
+
+% Full search
+if (~tracked)
+    [bestObjNum bestDist bestH] = ...
+        ransac_match_objmodel_ecv(om_,tom_,...
+                                  'numOfBestHypotheses',conf.numOfBestHypotheses,...
+                                  'randIters',conf.randIters,...
+                                  'useLineColour',conf.useLineColour,...
+                                  'lineColourMatchMethod',conf.lineColourMatchMethod,...
+                                  'numOfBestMatches',conf.numOfBestMatches,...
+                                  'locationDistanceMethod',conf.locationDistanceMethod,...
+                                  'UmeyamaScale',conf.UmeyamaScale,...
+                                  'reEstimate',conf.reEstimate,...
+                                  'reEstBest',conf.reEstBest,...
+                                  'posePrior',conf.posePrior,...
+                                  'debugLevel',conf.debugLevel);
+end;
+
+%%% INTERNALS
+function [dH] = local_perturbation(c_,dim_,maxRot_,maxTrans_)
+% Random rotation (max. maxRot_ degrees) around the point c_ and
+% random translation (max. maxTrans_ in every direction)
+ang = (2*rand(1)-1)*maxRot_*pi/180;
+if (dim_ == 3)
+    ax = randn(3,1);
+    ax = ax/norm(ax);
+    S = [0 -ax(3) ax(2); ax(3) 0 -ax(1); -ax(2) ax(1) 0];
+    R = eye(3)+sin(ang)*S+(1-cos(ang))*S*S; % Rodrigues
+else
+    R = [cos(ang) -sin(ang); sin(ang) cos(ang)];
+end;
+dt = (2*rand(dim_,1)-1)*maxTrans_;
+dH = [R c_-R*c_+dt; zeros(1,dim_) 1];
+
+function [str] = tracked_str(tracked_)
+if (tracked_)
+    str = 'tracked';
+else
+    str = 'full search';
+end;
@@ -0,0 +1,51 @@
+#!/bin/sh
+# This function measures how the sharded recognition scales: for every
+# number of shards 1..<max_shards> it starts the shard workers
+# (kit_shard_worker.m) as background Matlab processes on this machine,
+# runs the coordinator (kit_shard_demo.m) and lets the workers quit.
+# The average matching times are appended to conf.shard_timingFile
+# (KIT_shard_scaling.txt by default), one line per number of shards:
+#
+#  <num_of_shards> <num_of_test_items> <avg_match_time_s> <accuracy>
+#
+# Worker logs are written to <tempwork_dir>/shard_worker_<n>_<i>.log
+# If the coordinator fails, the workers are killed.
+# Usage: prompt:~>source data/KIT_shard_scaling.sh <max_shards> <mvprmatlab_dir> [<tempwork_dir>]
+# Run from the src/matlab directory (kit_demo_conf.m must exist).
+
+tempwork_dir="TEMPWORK_KIT"
+matlab_bin="matlab -nodesktop -nosplash"
+
+if [ $# -lt 2 ]; then
+    echo "Not enough input arguments!";
+    echo "Usage: source data/KIT_shard_scaling.sh <max_shards> <mvprmatlab_dir> [<tempwork_dir>]";
+    echo " Example: source data/KIT_shard_scaling.sh 4 ~/mvprmatlab";
+    return 1;
+fi;
+
+if [ $# -eq 3 ]; then
+    tempwork_dir=${3%/}; # removes last slash if exists
+fi;
+
+max_shards=$1;
+mvpr_dir=$2;
+
+for num_shards in `seq 1 $max_shards`; do
+    echo "==> $num_shards shard(s)";
+    worker_pids="";
+    for shard_ind in `seq 1 $num_shards`; do
+	$matlab_bin -r "try, SHARD_IND=$shard_ind; NUM_OF_SHARDS=$num_shards; addpath('$mvpr_dir'); addpath base; kit_shard_worker; catch e, disp(e.message); exit(1); end; exit" \
+	    > "${tempwork_dir}/shard_worker_${num_shards}_${shard_ind}.log" 2>&1 &
+	worker_pids="$worker_pids $!";
+    done;
+    # Coordinator waits until the workers have loaded their models and
+    # tells them to quit (whatever conf.shard_quitWorkers says)
+    if ! $matlab_bin -r "try, NUM_OF_SHARDS=$num_shards; QUIT_WORKERS=true; addpath('$mvpr_dir'); addpath base; kit_shard_demo; catch e, disp(e.message); exit(1); end; exit"; then
+	# Workers were not told to quit
+	echo "Coordinator failed - stopping the workers";
+	kill $worker_pids 2> /dev/null;
+    fi;
+    wait $worker_pids;
+done;
+
+echo "Done - Scaling measurements appended to the conf.shard_timingFile";
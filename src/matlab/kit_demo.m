@@ -45,6 +45,10 @@ else
     run('./kit_demo_conf');
     fprintf('...Done!!\n');
 end;
+% Older local config files do not have the sequence mode settings
+if (~isfield(conf,'sequenceMode'))
+    conf.sequenceMode = false;
+end;
 
 % Form the object database
 if (~conf.skip_trainmodel)
@@ -110,9 +114,29 @@ if (~conf.skip_testing)
         confInterrupted = conf;
         conf = confNew;
         clear confNew;
+        % Save files of older versions do not have the timing and
+        % sequence mode state
+        if (~exist('matchTime','var'))
+            matchTime = nan(numOfTestItems,1);
+        end;
+        if (~exist('tracked','var'))
+            tracked = false(numOfTestItems,1);
+        end;
+        if (~exist('prevObjNum','var'))
+            prevObjNum = nan; % no previous frame => full search
+            prevH = [];
+        end;
+        if (~exist('fullSearchDist','var'))
+            fullSearchDist = inf;
+        end;
     else
         detClass = nan(numOfTestItems,1);
         trueClass = nan(numOfTestItems,1);
+        matchTime = nan(numOfTestItems,1);
+        tracked = false(numOfTestItems,1);
+        prevObjNum = nan; % sequence mode: previous frame's best
+        prevH = [];
+        fullSearchDist = inf; % best distance of the last full search
         cInd_cont = 0;
     end;
 
@@ -150,8 +174,23 @@ if (~conf.skip_testing)
                    'locations and colours.']);
         end;
         
-        % Match the object to the database
-        [bestObjNum bestDist bestH] = ransac_match_objmodel_ecv(om,tomS,'debugLevel',conf.debugLevel);
+        % Match the object to the database (or track from the
+        % previous frame in the sequence mode)
+        matchStart = tic;
+        if (conf.sequenceMode)
+            [bestObjNum bestDist bestH tracked(cInd)] = ...
+                track_objmodel_ecv(om,tomS,prevObjNum,prevH,fullSearchDist,...
+                                   'degradeFactor',conf.sequenceDegradeFactor,...
+                                   'debugLevel',conf.debugLevel);
+            prevObjNum = bestObjNum(1);
+            prevH = bestH(:,:,1);
+            if (~tracked(cInd))
+                fullSearchDist = bestDist(1);
+            end;
+        else
+            [bestObjNum bestDist bestH] = ransac_match_objmodel_ecv(om,tomS,'debugLevel',conf.debugLevel);
+        end;
+        matchTime(cInd) = toc(matchStart);
         detClass(cInd) = bestObjNum(1);
         detH(:,:,cInd) = bestH(:,:,1);
         trueClass(cInd) = strmatch(tomS.objName,trueClasses,'exact');
@@ -177,6 +216,15 @@ if (~conf.skip_testing)
     end;
     mvpr_lclose(fh);
     fprintf([' => Final accuracy %f\n'],sum((detClass(1:cInd)-trueClass(1:cInd)==0))/cInd);
+    % Timing only of the items matched by this version (not of
+    % those in an older continued save file)
+    timed = find(~isnan(matchTime(1:cInd)));
+    fprintf(' => Average matching time %f s (%d items)\n',mean(matchTime(timed)),length(timed));
+    if (conf.sequenceMode)
+        fprintf(' => Tracked %d/%d (%f s per frame), full search %d/%d (%f s per frame)\n',...
+                sum(tracked(timed)),length(timed),mean(matchTime(timed(tracked(timed)))),...
+                sum(~tracked(timed)),length(timed),mean(matchTime(timed(~tracked(timed)))));
+    end;
     fprintf('[1] done!\n');
     confMatr = zeros(max(trueClass));
     % Confusion matrix
@@ -0,0 +1,126 @@
+%KIT_SHARD_DEMO Sharded (scatter-gather) version of kit_demo.m
+%
+% The object database is held by the shard workers
+% (kit_shard_worker.m) and this coordinator only reads the test
+% observations, broadcasts them to the workers and merges their
+% best hypotheses (ransac_match_sharded_ecv.m). The workers must be
+% started first (see data/KIT_shard_scaling.sh), optionally set the
+% number of shards (default conf.shard_numOfShards) and whether the
+% workers quit afterwards (default conf.shard_quitWorkers):
+%
+%  >> NUM_OF_SHARDS = 2; QUIT_WORKERS = true; kit_shard_demo
+%
+% The accuracy, confusion matrix and the average matching time are
+% computed as in kit_demo.m and the timing is appended to
+% conf.shard_timingFile (one line per run: number of shards, number
+% of test items, average matching time in seconds and accuracy).
+%
+% Author(s):
+%    Joni Kamarainen, CoViL in 2011.
+%
+% Project:
+%  -
+%
+% Copyright:
+%
+%   Copyright (C) 2011-2012 by Cognitive Vision Laboratory,
+%   SDU <norbert@mmmi.sdu.dk> and Joni Kamarainen <Joni.Kamarainen@lut.fi>
+%
+% References:
+%  [1] Kamarainen, J.-K., Buch, A.G., Krueger, N., 3D Object Detection
+%      Using Accumulated Early Vision Primitives, submitted.
+%
+% See also KIT_SHARD_WORKER.M and KIT_DEMO.M .
+%
+fprintf('-------------------------------------------\n');
+fprintf('Sharded 3D object recognition demo for     \n');
+fprintf('objects in the KIT dataset                 \n');
+fprintf('-------------------------------------------\n');
+
+% Run the config script
+if (exist('KIT_CONFIG','var'))
+    fprintf(['Using user given config KIT_CONFIG=''' KIT_CONFIG ''' to read parameters...']);
+    run(KIT_CONFIG);
+    fprintf('...Done!!\n');
+else
+    fprintf('Loading parameters from kit_demo_conf.m...');
+    run('./kit_demo_conf');
+    fprintf('...Done!!\n');
+end;
+if (exist('NUM_OF_SHARDS','var'))
+    conf.shard_numOfShards = NUM_OF_SHARDS;
+end;
+if (exist('QUIT_WORKERS','var'))
+    conf.shard_quitWorkers = QUIT_WORKERS;
+end;
+if (~isfield(conf,'shard_readTimeout'))
+    conf.shard_readTimeout = 600;
+end;
+
+% Only the class names of the database (models are in the workers)
+numOfClasses = mvpr_lcountentries(conf.tr_data_file,'comment','#%');
+fh = mvpr_lopen(conf.tr_data_file, 'read','comment','#%');
+for cInd = 1:numOfClasses
+    fline = mvpr_lread(fh);
+    trueClasses{cInd} = fline{3};
+end;
+mvpr_lclose(fh);
+
+fprintf('[1] Connecting to %d shard workers...\n',conf.shard_numOfShards);
+shards = shard_connect_ecv(conf.shard_basePort+(0:conf.shard_numOfShards-1),...
+                           'readTimeout',conf.shard_readTimeout);
+fprintf('[1] done!\n');
+
+numOfTestItems = min([conf.shard_numOfTestItems ...
+                    mvpr_lcountentries(conf.te_data_file,'comment','#%')]);
+fprintf(['[2] Reading primitive test files and matching to database shards...\n']);
+fh = mvpr_lopen(conf.te_data_file, 'read','comment','#%');
+detClass = nan(numOfTestItems,1);
+trueClass = nan(numOfTestItems,1);
+matchTime = nan(numOfTestItems,1);
+for cInd = 1:numOfTestItems
+    fline = mvpr_lread(fh);
+    fprintf(['\r Reading %4d/%4d (curr accuracy %f) %s'], cInd, numOfTestItems,...
+            sum((detClass(1:cInd-1)-trueClass(1:cInd-1)) == 0)/(cInd-1),strtrim(fline{4}));
+    prims = xmlReadPrimitives(...
+        fullfile(conf.temp_dir,...
+                 ['Slam_output_' fline{4}],...
+                 ['primitives3D_' conf.slam_prim_file_id '.xml']));
+    if (conf.use2DPrimitives)
+      prims2D = read2DPrimitives(fullfile(conf.temp_dir,...
+                                          ['Slam_output_' fline{4}],...
+                                          ['primitives_left_' ...
+                          conf.slam_2d_prim_file_id '.primitives']));
+      tomS = objmodel_ecv(prims,'use2D',conf.use2DPrimitives,'prims2D',prims2D,'method2D',conf.method2D,'debugLevel',conf.debugLevel);
+    else
+      tomS = objmodel_ecv(prims,'debugLevel',conf.debugLevel);
+    end;
+    tomS.objName = fline{5};
+
+    % Match the object to the database shards
+    matchStart = tic;
+    [bestObjNum bestDist bestH] = ransac_match_sharded_ecv(shards,tomS,'debugLevel',conf.debugLevel);
+    matchTime(cInd) = toc(matchStart);
+    detClass(cInd) = bestObjNum(1);
+    detH(:,:,cInd) = bestH(:,:,1);
+    trueClass(cInd) = strmatch(tomS.objName,trueClasses,'exact');
+end;
+mvpr_lclose(fh);
+shard_disconnect_ecv(shards,'quitWorkers',conf.shard_quitWorkers);
+
+accuracy = sum((detClass(1:cInd)-trueClass(1:cInd)==0))/cInd;
+fprintf([' => Final accuracy %f\n'],accuracy);
+fprintf(' => Average matching time %f s (%d shards)\n',mean(matchTime),conf.shard_numOfShards);
+fprintf('[2] done!\n');
+confMatr = zeros(max(trueClass));
+% Confusion matrix
+for coi1 = 1:max(trueClass)
+    for coi2 = 1:max(trueClass)
+        confMatr(coi1,coi2) = sum(detClass(find(coi1==trueClass))==coi2);
+    end;
+end;
+
+% Scaling measurements
+tfh = fopen(conf.shard_timingFile,'a');
+fprintf(tfh,'%d %d %f %f\n',conf.shard_numOfShards,numOfTestItems,mean(matchTime),accuracy);
+fclose(tfh);
@@ -0,0 +1,89 @@
+%KIT_SHARD_WORKER Shard worker of the sharded KIT recognition demo
+%
+% Loads one shard of the KIT object database and serves matching
+% requests of kit_shard_demo.m through a local socket. Set the
+% shard number before running (and optionally the number of shards,
+% default conf.shard_numOfShards):
+%
+%  >> SHARD_IND = 1; NUM_OF_SHARDS = 2; kit_shard_worker
+%
+% The database objects are assigned to the shards round robin
+% (object i to shard mod(i-1,NUM_OF_SHARDS)+1) and the shard listens
+% to the port conf.shard_basePort+SHARD_IND-1. See
+% data/KIT_shard_scaling.sh for starting the workers and the
+% coordinator from the shell.
+%
+% Author(s):
+%    Joni Kamarainen, CoViL in 2011.
+%
+% Project:
+%  -
+%
+% Copyright:
+%
+%   Copyright (C) 2011-2012 by Cognitive Vision Laboratory,
+%   SDU <norbert@mmmi.sdu.dk> and Joni Kamarainen <Joni.Kamarainen@lut.fi>
+%
+% References:
+%  [1] Kamarainen, J.-K., Buch, A.G., Krueger, N., 3D Object Detection
+%      Using Accumulated Early Vision Primitives, submitted.
+%
+% See also KIT_SHARD_DEMO.M and KIT_DEMO.M .
+%
+if (~exist('SHARD_IND','var'))
+    error('Set SHARD_IND (1..NUM_OF_SHARDS) before running kit_shard_worker');
+end;
+
+% Run the config script
+if (exist('KIT_CONFIG','var'))
+    fprintf(['Using user given config KIT_CONFIG=''' KIT_CONFIG ''' to read parameters...']);
+    run(KIT_CONFIG);
+    fprintf('...Done!!\n');
+else
+    fprintf('Loading parameters from kit_demo_conf.m...');
+    run('./kit_demo_conf');
+    fprintf('...Done!!\n');
+end;
+if (exist('NUM_OF_SHARDS','var'))
+    conf.shard_numOfShards = NUM_OF_SHARDS;
+end;
+if (~isfield(conf,'shard_ransacArgs'))
+    conf.shard_ransacArgs = {};
+end;
+
+% Form the object database of this shard
+fprintf('[1] Reading training primitives of shard %d/%d...\n',SHARD_IND,conf.shard_numOfShards);
+clear om;
+shardObjNums = [];
+numOfClasses = mvpr_lcountentries(conf.tr_data_file,'comment','#%');
+fh = mvpr_lopen(conf.tr_data_file, 'read','comment','#%');
+for cInd = 1:numOfClasses
+    fline = mvpr_lread(fh);
+    if (mod(cInd-1,conf.shard_numOfShards) ~= SHARD_IND-1)
+        continue; % other shard's model
+    end;
+    fprintf(['\r Forming model %4d/%4d (' fline{3} ')                 '],cInd,numOfClasses);
+    prims = xmlReadPrimitives(...
+        fullfile(conf.temp_dir,...
+                 ['Slam_output_' fline{3}],...
+                 ['primitives3D_' conf.slam_prim_file_id '.xml']));
+    if (conf.use2DPrimitives)
+      prims2D = read2DPrimitives(fullfile(conf.temp_dir,...
+                                          ['Slam_output_' fline{3}],...
+                                          ['primitives_left_' ...
+                          conf.slam_2d_prim_file_id '.primitives']));
+      omS = objmodel_ecv(prims,'use2D',conf.use2DPrimitives,'prims2D',prims2D,'method2D',conf.method2D,'debugLevel',conf.debugLevel);
+    else
+      omS = objmodel_ecv(prims,'debugLevel',conf.debugLevel);
+    end;
+    omS.objName = fline{3};
+    shardObjNums(end+1) = cInd;
+    om(length(shardObjNums)) = omS;
+end;
+mvpr_lclose(fh);
+fprintf('[1] done!\n');
+
+% Serve until the coordinator tells to quit
+shard_worker_ecv(om,shardObjNums,conf.shard_basePort+SHARD_IND-1,...
+                 'ransacArgs',conf.shard_ransacArgs,...
+                 'debugLevel',conf.debugLevel);
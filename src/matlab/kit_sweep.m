@@ -0,0 +1,182 @@
+%KIT_SWEEP RANSAC parameter sweep of the KIT recognition demo
+%
+% Runs the recognition of kit_demo.m for every combination of the
+% ransac_match_objmodel_ecv parameters given in the conf.sweep_*
+% settings (randIters, numOfBestMatches, locationDistanceMethod,
+% UmeyamaScale and reEstimate) in one go:
+%
+%  >> kit_sweep
+%
+% The database models and the test observations are read only once.
+% The test items are run in a parfor loop, which hands them out
+% dynamically to the workers of an open Matlab pool
+% (matlabpool/parpool) and runs serially without one. The models are
+% sent to every worker once, but every observation only to the worker
+% running it. There the match matrices of the observation to every
+% model are computed once (match_matrices_ecv.m) for the largest
+% numOfBestMatches and shared by all configurations of the item.
+%
+% For every configuration the accuracy, the confusion matrix and the
+% average matching time are stored to conf.sweep_saveFile and one
+% line per configuration (randIters numOfBestMatches
+% locationDistanceMethod UmeyamaScale reEstimate accuracy average
+% matching time in seconds) is written to conf.sweep_resultFile.
+%
+% Author(s):
+%    Joni Kamarainen, CoViL in 2011.
+%
+% Project:
+%  -
+%
+% Copyright:
+%
+%   Copyright (C) 2011-2012 by Cognitive Vision Laboratory,
+%   SDU <norbert@mmmi.sdu.dk> and Joni Kamarainen <Joni.Kamarainen@lut.fi>
+%
+% References:
+%  [1] Kamarainen, J.-K., Buch, A.G., Krueger, N., 3D Object Detection
+%      Using Accumulated Early Vision Primitives, submitted.
+%
+% See also KIT_DEMO.M and RANSAC_MATCH_OBJMODEL_ECV.M .
+%
+fprintf('-------------------------------------------\n');
+fprintf('RANSAC parameter sweep of 3D object        \n');
+fprintf('recognition in the KIT dataset             \n');
+fprintf('-------------------------------------------\n');
+
+% Run the config script
+if (exist('KIT_CONFIG','var'))
+    fprintf(['Using user given config KIT_CONFIG=''' KIT_CONFIG ''' to read parameters...']);
+    run(KIT_CONFIG);
+    fprintf('...Done!!\n');
+else
+    fprintf('Loading parameters from kit_demo_conf.m...');
+    run('./kit_demo_conf');
+    fprintf('...Done!!\n');
+end;
+
+% Form the object database
+fprintf('[1] Reading training primitives and forming object models...\n');
+clear om;
+numOfClasses = mvpr_lcountentries(conf.tr_data_file,'comment','#%');
+fh = mvpr_lopen(conf.tr_data_file, 'read','comment','#%');
+for cInd = 1:numOfClasses
+    fline = mvpr_lread(fh);
+    fprintf(['\r Forming model %4d/%4d (' fline{3} ')                 '],cInd,numOfClasses);
+    prims = xmlReadPrimitives(...
+        fullfile(conf.temp_dir,...
+                 ['Slam_output_' fline{3}],...
+                 ['primitives3D_' conf.slam_prim_file_id '.xml']));
+    if (conf.use2DPrimitives)
+      prims2D = read2DPrimitives(fullfile(conf.temp_dir,...
+                                          ['Slam_output_' fline{3}],...
+                                          ['primitives_left_' ...
+                          conf.slam_2d_prim_file_id '.primitives']));
+      omS = objmodel_ecv(prims,'use2D',conf.use2DPrimitives,'prims2D',prims2D,'method2D',conf.method2D,'debugLevel',conf.debugLevel);
+    else
+      omS = objmodel_ecv(prims,'debugLevel',conf.debugLevel);
+    end;
+    omS.objName = fline{3};
+    trueClasses{cInd} = fline{3};
+    om(cInd) = omS;
+end;
+mvpr_lclose(fh);
+fprintf('[1] done!\n');
+
+% Read all test observations
+numOfTestItems = min([conf.sweep_numOfTestItems ...
+                    mvpr_lcountentries(conf.te_data_file,'comment','#%')]);
+fprintf('[2] Reading primitive test files...\n');
+clear tom;
+trueClass = nan(numOfTestItems,1);
+fh = mvpr_lopen(conf.te_data_file, 'read','comment','#%');
+for tInd = 1:numOfTestItems
+    fline = mvpr_lread(fh);
+    fprintf(['\r Reading %4d/%4d %s'], tInd, numOfTestItems, strtrim(fline{4}));
+    prims = xmlReadPrimitives(...
+        fullfile(conf.temp_dir,...
+                 ['Slam_output_' fline{4}],...
+                 ['primitives3D_' conf.slam_prim_file_id '.xml']));
+    if (conf.use2DPrimitives)
+      prims2D = read2DPrimitives(fullfile(conf.temp_dir,...
+                                          ['Slam_output_' fline{4}],...
+                                          ['primitives_left_' ...
+                          conf.slam_2d_prim_file_id '.primitives']));
+      tomS = objmodel_ecv(prims,'use2D',conf.use2DPrimitives,'prims2D',prims2D,'method2D',conf.method2D,'debugLevel',conf.debugLevel);
+    else
+      tomS = objmodel_ecv(prims,'debugLevel',conf.debugLevel);
+    end;
+    tomS.objName = fline{5};
+    trueClass(tInd) = strmatch(tomS.objName,trueClasses,'exact');
+    tom(tInd) = tomS;
+end;
+mvpr_lclose(fh);
+fprintf('[2] done!\n');
+
+% Configuration grid (one row per configuration)
+[gRandIters gNumOfBestMatches gLocationDistanceMethod gUmeyamaScale gReEstimate] = ...
+    ndgrid(conf.sweep_randIters, conf.sweep_numOfBestMatches,...
+           conf.sweep_locationDistanceMethod, conf.sweep_UmeyamaScale,...
+           double(conf.sweep_reEstimate));
+sweepConfs = [gRandIters(:) gNumOfBestMatches(:) gLocationDistanceMethod(:) ...
+              gUmeyamaScale(:) gReEstimate(:)];
+numOfConfs = size(sweepConfs,1);
+
+% Test items in a parfor loop: the observation tom(tInd) is sliced
+% (only sent to the worker running the item) and its match matrices
+% are computed there once for the largest numOfBestMatches and shared
+% by all configurations. Only the database models are sent to every
+% worker.
+fprintf('[3] Matching %d test items x %d configurations...\n',numOfTestItems,numOfConfs);
+detClass = nan(numOfTestItems,numOfConfs);
+matchTime = nan(numOfTestItems,numOfConfs);
+cacheTimes = nan(numOfTestItems,1);
+sweepStart = tic;
+parfor tInd = 1:numOfTestItems
+    tomS = tom(tInd);
+    cacheStart = tic;
+    mms = match_matrices_ecv(om,tomS,...
+                             'numOfBestMatches',max(conf.sweep_numOfBestMatches));
+    cacheTimes(tInd) = toc(cacheStart);
+    itemDetClass = nan(1,numOfConfs);
+    itemMatchTime = nan(1,numOfConfs);
+    for confInd = 1:numOfConfs
+        matchStart = tic;
+        bestObjNum = ransac_match_objmodel_ecv(om,tomS,...
+                                               'randIters',sweepConfs(confInd,1),...
+                                               'numOfBestMatches',sweepConfs(confInd,2),...
+                                               'locationDistanceMethod',sweepConfs(confInd,3),...
+                                               'UmeyamaScale',sweepConfs(confInd,4),...
+                                               'reEstimate',sweepConfs(confInd,5) ~= 0,...
+                                               'matchMatrices',mms);
+        itemMatchTime(confInd) = toc(matchStart);
+        itemDetClass(confInd) = bestObjNum(1);
+    end;
+    detClass(tInd,:) = itemDetClass;
+    matchTime(tInd,:) = itemMatchTime;
+end;
+sweepTime = toc(sweepStart);
+cacheTime = sum(cacheTimes);
+fprintf('[3] done! (%f s)\n',sweepTime);
+
+% Accuracy, confusion matrix and timing per configuration
+accuracy = nan(numOfConfs,1);
+confMatr = zeros(numOfClasses,numOfClasses,numOfConfs);
+rfh = fopen(conf.sweep_resultFile,'w');
+fprintf(rfh,'# randIters numOfBestMatches locationDistanceMethod UmeyamaScale reEstimate accuracy matchTime\n');
+for confInd = 1:numOfConfs
+    accuracy(confInd) = sum(detClass(:,confInd) == trueClass)/numOfTestItems;
+    for coi1 = 1:numOfClasses
+        for coi2 = 1:numOfClasses
+            confMatr(coi1,coi2,confInd) = sum(detClass(find(coi1==trueClass),confInd)==coi2);
+        end;
+    end;
+    fprintf(' => randIters=%d numOfBestMatches=%d locationDistanceMethod=%d UmeyamaScale=%d reEstimate=%d: accuracy %f, average matching time %f s\n',...
+            sweepConfs(confInd,:),accuracy(confInd),mean(matchTime(:,confInd)));
+    fprintf(rfh,'%d %d %d %d %d %f %f\n',sweepConfs(confInd,:),accuracy(confInd),mean(matchTime(:,confInd)));
+end;
+fclose(rfh);
+fprintf(' => Sweep %f s (sequential: match matrices %f s, matching %f s)\n',...
+        sweepTime,cacheTime,sum(matchTime(:)));
+save(conf.sweep_saveFile,'sweepConfs','trueClass','detClass','matchTime',...
+     'accuracy','confMatr','cacheTime','sweepTime');
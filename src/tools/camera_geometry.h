@@ -0,0 +1,263 @@
+/*
+ * @brief Header-only analytic camera library: value-type K, R, t and P
+ *        and batched (SIMD) transformation and projection of points.
+ *
+ * No VTK objects are allocated and thus the functions can be used to
+ * project bounding boxes, primitives and depth maps for thousands of
+ * views. Points are given as separate coordinate arrays (x[], y[], z[]),
+ * which is also the layout of the bounding boxes (bbox[3][8]) in
+ * render_stereo_pair.
+ *
+ * Coordinate conventions (camera frame and image origin):
+ *
+ *  CAM_VTK    - x right, y up, camera looks toward negative z,
+ *               image origin at the bottom left corner
+ *  CAM_COVIS  - x right, y down, z away from the camera (right hand system),
+ *               image origin at the upper left corner
+ *  CAM_OPENCV - same as CoViS (the calibration files written by
+ *               SaveStereoCalibrationOpenCV() are read by both)
+ *
+ * Copyright (c)
+ *      Cognitive Vision Laboratory, SDU <norbert@mmmi.sdu.dk>
+ *      Joni Kamarainen <Joni.Kamarainen@lut.fi>
+ *
+ * References:
+ *  [1] Hartley, R., and Zisserman, A., Multiple View Geometry in Computer
+ *      Vision, 2003.
+ */
+
+/* -*- c-file-style: "bsd" -*- */
+
+#ifndef CAMERA_GEOMETRY_H
+#define CAMERA_GEOMETRY_H
+
+#include <cmath>
+#include <cstddef>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+enum CamConvention {
+   CAM_VTK = 0,
+   CAM_COVIS = 1,
+   CAM_OPENCV = 2
+};
+
+/**
+ * @brief Intrinsic camera matrix K (eq. (6.10) in ref. [1])
+ **/
+struct CamK {
+   double m[3][3];
+};
+
+/**
+ * @brief Rotation matrix R
+ **/
+struct CamR {
+   double m[3][3];
+};
+
+/**
+ * @brief Translation vector t, world to camera: X_cam = R*X + t
+ **/
+struct CamT {
+   double v[3];
+};
+
+/**
+ * @brief Camera matrix P = K[R|t] (eq. (6.8) in ref. [1])
+ **/
+struct CamP {
+   double m[3][4];
+};
+
+/**
+ * @brief K of a pinhole camera of the given image size and view angle
+ *        (degrees), principal point at the image centre (the K of
+ *        CanonicStereoCameraMatrix_CoViS() in render_stereo_pair).
+ **/
+inline CamK CamKFromViewAngle(const int sz[], const double fov) {
+   CamK K;
+   K.m[0][0] = sz[0] / 2 / std::tan(fov * M_PI / 2 / 180.0);
+   K.m[0][1] = 0;
+   K.m[0][2] = sz[0] / 2;
+   K.m[1][0] = 0;
+   K.m[1][1] = sz[1] / 2 / std::tan(fov * M_PI / 2 / 180.0);
+   K.m[1][2] = sz[1] / 2;
+   K.m[2][0] = 0;
+   K.m[2][1] = 0;
+   K.m[2][2] = 1;
+   return K;
+}
+
+/**
+ * @brief Identity rotation
+ **/
+inline CamR CamRIdentity() {
+   CamR R;
+   for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 3; j++)
+         R.m[i][j] = (i == j) ? 1 : 0;
+   return R;
+}
+
+/**
+ * @brief R and t from a 4x4 homogeneous (row major) world to camera
+ *        transformation, e.g. vtkCamera::GetViewTransformMatrix()->Element.
+ **/
+inline void CamRtFromMatrix4x4(const double M[][4], CamR &R, CamT &t) {
+   for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++)
+         R.m[i][j] = M[i][j];
+      t.v[i] = M[i][3];
+   }
+}
+
+/**
+ * @brief Converts the camera frame of R and t from one convention to
+ *        another. VTK <-> CoViS/OpenCV is a rotation of 180 degrees around
+ *        the x axis, i.e. the y and z rows change their signs.
+ **/
+inline void CamConvertRt(const CamConvention from, const CamConvention to,
+                         CamR &R, CamT &t) {
+   const bool fromVTK = (from == CAM_VTK);
+   const bool toVTK = (to == CAM_VTK);
+   if (fromVTK == toVTK)
+      return; // CoViS and OpenCV share the convention
+   for (int i = 1; i < 3; i++) {
+      for (int j = 0; j < 3; j++)
+         R.m[i][j] = -R.m[i][j];
+      t.v[i] = -t.v[i];
+   }
+}
+
+/**
+ * @brief Converts image coordinates (v only) between the bottom left (VTK)
+ *        and upper left (CoViS/OpenCV) origins for an image of the given
+ *        height.
+ **/
+inline double CamConvertImageV(const CamConvention from, const CamConvention to,
+                               const double v, const int height) {
+   if ((from == CAM_VTK) == (to == CAM_VTK))
+      return v;
+   return height - v;
+}
+
+/**
+ * @brief P = K[R|t]
+ **/
+inline CamP CamComposeP(const CamK &K, const CamR &R, const CamT &t) {
+   CamP P;
+   for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++)
+         P.m[i][j] = K.m[i][0] * R.m[0][j] + K.m[i][1] * R.m[1][j] + K.m[i][2] * R.m[2][j];
+      P.m[i][3] = K.m[i][0] * t.v[0] + K.m[i][1] * t.v[1] + K.m[i][2] * t.v[2];
+   }
+   return P;
+}
+
+/**
+ * @brief Transforms n points to the camera frame: X_cam = R*X + t.
+ *        The output arrays may be the input arrays.
+ **/
+inline void CamTransformPoints(const CamR &R, const CamT &t,
+                               const double *x, const double *y, const double *z,
+                               const size_t n,
+                               double *xo, double *yo, double *zo) {
+   size_t i = 0;
+#ifdef __SSE2__
+   __m128d r[3][3], tv[3];
+   for (int ri = 0; ri < 3; ri++) {
+      for (int rj = 0; rj < 3; rj++)
+         r[ri][rj] = _mm_set1_pd(R.m[ri][rj]);
+      tv[ri] = _mm_set1_pd(t.v[ri]);
+   }
+   for (; i + 2 <= n; i += 2) {
+      const __m128d px = _mm_loadu_pd(x + i);
+      const __m128d py = _mm_loadu_pd(y + i);
+      const __m128d pz = _mm_loadu_pd(z + i);
+      __m128d o[3];
+      for (int ri = 0; ri < 3; ri++)
+         o[ri] = _mm_add_pd(_mm_add_pd(_mm_mul_pd(r[ri][0], px), _mm_mul_pd(r[ri][1], py)),
+                            _mm_add_pd(_mm_mul_pd(r[ri][2], pz), tv[ri]));
+      _mm_storeu_pd(xo + i, o[0]);
+      _mm_storeu_pd(yo + i, o[1]);
+      _mm_storeu_pd(zo + i, o[2]);
+   }
+#endif
+   for (; i < n; i++) {
+      const double px = x[i], py = y[i], pz = z[i];
+      xo[i] = R.m[0][0] * px + R.m[0][1] * py + R.m[0][2] * pz + t.v[0];
+      yo[i] = R.m[1][0] * px + R.m[1][1] * py + R.m[1][2] * pz + t.v[1];
+      zo[i] = R.m[2][0] * px + R.m[2][1] * py + R.m[2][2] * pz + t.v[2];
+   }
+}
+
+/**
+ * @brief Projects n world points to the image by P: (u,v) = (p1*X/p3*X,
+ *        p2*X/p3*X), where pi is the i:th row of P. Depth (p3*X, positive
+ *        in front of a CoViS/OpenCV camera) is stored if w is not NULL.
+ **/
+inline void CamProjectPoints(const CamP &P,
+                             const double *x, const double *y, const double *z,
+                             const size_t n,
+                             double *u, double *v, double *w = NULL) {
+   size_t i = 0;
+#ifdef __SSE2__
+   __m128d p[3][4];
+   for (int pi = 0; pi < 3; pi++)
+      for (int pj = 0; pj < 4; pj++)
+         p[pi][pj] = _mm_set1_pd(P.m[pi][pj]);
+   for (; i + 2 <= n; i += 2) {
+      const __m128d px = _mm_loadu_pd(x + i);
+      const __m128d py = _mm_loadu_pd(y + i);
+      const __m128d pz = _mm_loadu_pd(z + i);
+      __m128d h[3];
+      for (int pi = 0; pi < 3; pi++)
+         h[pi] = _mm_add_pd(_mm_add_pd(_mm_mul_pd(p[pi][0], px), _mm_mul_pd(p[pi][1], py)),
+                            _mm_add_pd(_mm_mul_pd(p[pi][2], pz), p[pi][3]));
+      _mm_storeu_pd(u + i, _mm_div_pd(h[0], h[2]));
+      _mm_storeu_pd(v + i, _mm_div_pd(h[1], h[2]));
+      if (w != NULL)
+         _mm_storeu_pd(w + i, h[2]);
+   }
+#endif
+   for (; i < n; i++) {
+      const double h0 = P.m[0][0] * x[i] + P.m[0][1] * y[i] + P.m[0][2] * z[i] + P.m[0][3];
+      const double h1 = P.m[1][0] * x[i] + P.m[1][1] * y[i] + P.m[1][2] * z[i] + P.m[1][3];
+      const double h2 = P.m[2][0] * x[i] + P.m[2][1] * y[i] + P.m[2][2] * z[i] + P.m[2][3];
+      u[i] = h0 / h2;
+      v[i] = h1 / h2;
+      if (w != NULL)
+         w[i] = h2;
+   }
+}
+
+/**
+ * @brief Back-projects a depth map (depth along the optical axis, row
+ *        major, CoViS/OpenCV image origin) to camera frame points by K.
+ *        Pixels of non-positive depth get NaN coordinates.
+ **/
+inline void CamBackProjectDepth(const CamK &K, const double *depth,
+                                const int width, const int height,
+                                double *xo, double *yo, double *zo) {
+   const double ifx = 1.0 / K.m[0][0];
+   const double ify = 1.0 / K.m[1][1];
+   for (int row = 0; row < height; row++) {
+      const double yn = (row - K.m[1][2]) * ify;
+      for (int col = 0; col < width; col++) {
+         const size_t i = (size_t)row * width + col;
+         const double d = depth[i];
+         if (d > 0) {
+            xo[i] = (col - K.m[0][2]) * ifx * d;
+            yo[i] = yn * d;
+            zo[i] = d;
+         } else {
+            xo[i] = yo[i] = zo[i] = NAN;
+         }
+      }
+   }
+}
+
+#endif /* CAMERA_GEOMETRY_H */
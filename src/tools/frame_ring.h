@@ -0,0 +1,342 @@
+/*
+ * @brief Shared memory ring buffer of rendered stereo frames (header-only).
+ *
+ * render_stereo_pair --stream_output publishes the left and right frame
+ * buffers and their K, R and t (as in the _CoViS_canonic calibration
+ * files) into a POSIX shared memory object and a downstream process
+ * (e.g. a primitive extractor, see frame_ring_dump.cpp) consumes them
+ * without PNG encoding/decoding or file creation. One producer and one
+ * consumer; the producer blocks when all slots are full (backpressure)
+ * and the consumer blocks when all are empty. Both give up after the
+ * timeout given to FrameRingCreate()/FrameRingOpen() (a missing or dead
+ * peer) and print an error.
+ *
+ * Layout of the shared memory object /<name> (native byte order):
+ *
+ *  offset 0                  FrameRingHeader (padded to FRAME_RING_HEADER_SIZE)
+ *  FRAME_RING_HEADER_SIZE    slot 0
+ *  ... + i*slotSize          slot i (i = 0..numOfSlots-1)
+ *
+ *  Every slot:
+ *   offset 0                 FrameRingSlot (padded to FRAME_RING_SLOT_HEADER_SIZE)
+ *   FRAME_RING_SLOT_HEADER_SIZE      left image, width*height*channels bytes
+ *   ... + width*height*channels      right image, -"-
+ *
+ *  Images are 8-bit interleaved (RGB), rows bottom-up (the VTK image
+ *  origin is at the bottom left corner) unless originBottomLeft is 0.
+ *  The frame i is in slot (i mod numOfSlots). The semaphores freeSlots and
+ *  fullSlots in the header count the free and written slots.
+ *
+ * Copyright (c)
+ *      Cognitive Vision Laboratory, SDU <norbert@mmmi.sdu.dk>
+ *      Joni Kamarainen <Joni.Kamarainen@lut.fi>
+ */
+
+/* -*- c-file-style: "bsd" -*- */
+
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctime>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define FRAME_RING_MAGIC 0x474e5246 // "FRNG"
+#define FRAME_RING_VERSION 1
+#define FRAME_RING_HEADER_SIZE 4096
+#define FRAME_RING_SLOT_HEADER_SIZE 1024
+#define FRAME_RING_NAME_LENGTH 256
+
+/**
+ * @brief Ring header (at the beginning of the shared memory object)
+ **/
+struct FrameRingHeader {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t numOfSlots;
+   uint32_t maxWidth; // slot capacity
+   uint32_t maxHeight;
+   uint32_t channels;
+   uint64_t slotSize; // bytes per slot including the slot header
+   uint64_t writeCount; // frames published (producer only writes)
+   uint64_t readCount; // frames consumed (consumer only writes)
+   uint32_t producerDone; // no more frames after writeCount
+   sem_t freeSlots; // process shared
+   sem_t fullSlots; // process shared
+};
+
+/**
+ * @brief Slot header, camera matrices as in SaveStereoCalibrationOpenCV()
+ **/
+struct FrameRingSlot {
+   uint64_t frameIndex;
+   int32_t width;
+   int32_t height;
+   int32_t channels;
+   int32_t originBottomLeft;
+   double K_l[3][3];
+   double R_l[3][3];
+   double t_l[3];
+   double K_r[3][3];
+   double R_r[3][3];
+   double t_r[3];
+   char name[FRAME_RING_NAME_LENGTH]; // e.g. the image file name without "_left"
+};
+
+/**
+ * @brief Process local handle of the ring
+ **/
+struct FrameRing {
+   std::string name;
+   int fd;
+   size_t size;
+   unsigned char *base;
+   FrameRingHeader *header;
+   bool owner; // producer created the object
+   int timeout; // seconds to wait for the peer, <= 0 waits forever
+};
+
+/**
+ * @brief Slot i of the ring
+ **/
+inline FrameRingSlot *FrameRingSlotAt(const FrameRing &ring, const uint64_t i) {
+   return reinterpret_cast<FrameRingSlot *>(ring.base + FRAME_RING_HEADER_SIZE +
+                                            (i % ring.header->numOfSlots) * ring.header->slotSize);
+}
+
+/**
+ * @brief Left and right image data of a slot
+ **/
+inline unsigned char *FrameRingLeftPixels(FrameRingSlot *slot) {
+   return reinterpret_cast<unsigned char *>(slot) + FRAME_RING_SLOT_HEADER_SIZE;
+}
+inline unsigned char *FrameRingRightPixels(FrameRingSlot *slot) {
+   return FrameRingLeftPixels(slot) + (size_t)slot->width * slot->height * slot->channels;
+}
+
+/**
+ * @brief Waits for the semaphore at most timeout seconds (forever if
+ *        timeout <= 0). Returns 0 on success.
+ **/
+inline int FrameRingSemWait(sem_t *sem, const int timeout) {
+   if (timeout <= 0) {
+      while (sem_wait(sem) != 0) {
+         if (errno != EINTR)
+            return -1;
+      }
+      return 0;
+   }
+   struct timespec deadline;
+   clock_gettime(CLOCK_REALTIME, &deadline);
+   deadline.tv_sec += timeout;
+   while (sem_timedwait(sem, &deadline) != 0) {
+      if (errno != EINTR)
+         return -1; // ETIMEDOUT
+   }
+   return 0;
+}
+
+/**
+ * @brief True if waited seconds exceed the timeout (never if timeout <= 0)
+ **/
+inline bool FrameRingTimedOut(const int waited, const int timeout) {
+   return timeout > 0 && waited >= timeout;
+}
+
+/**
+ * @brief Producer: creates (or re-creates) the shared memory object, the
+ *        producer waits at most timeout seconds for a free slot.
+ *        Returns 0 on success.
+ **/
+inline int FrameRingCreate(FrameRing &ring, const std::string &name,
+                           const int numOfSlots, const int maxWidth,
+                           const int maxHeight, const int channels,
+                           const int timeout) {
+   ring.name = (name[0] == '/') ? name : "/" + name;
+   ring.owner = true;
+   ring.timeout = timeout;
+   const uint64_t slotSize =
+      ((FRAME_RING_SLOT_HEADER_SIZE + 2 * (uint64_t)maxWidth * maxHeight * channels + 63) / 64) * 64;
+   ring.size = FRAME_RING_HEADER_SIZE + numOfSlots * slotSize;
+
+   shm_unlink(ring.name.c_str()); // stale ring of a crashed producer
+   ring.fd = shm_open(ring.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+   if (ring.fd < 0) {
+      std::cerr << "Cannot create shared memory " << ring.name << ": " << strerror(errno) << std::endl;
+      return -1;
+   }
+   void *base = MAP_FAILED;
+   if (ftruncate(ring.fd, ring.size) == 0)
+      base = mmap(NULL, ring.size, PROT_READ | PROT_WRITE, MAP_SHARED, ring.fd, 0);
+   if (base == MAP_FAILED) {
+      std::cerr << "Cannot allocate shared memory " << ring.name << ": " << strerror(errno) << std::endl;
+      close(ring.fd);
+      shm_unlink(ring.name.c_str());
+      return -1;
+   }
+   ring.base = static_cast<unsigned char *>(base);
+   ring.header = reinterpret_cast<FrameRingHeader *>(ring.base);
+   ring.header->version = FRAME_RING_VERSION;
+   ring.header->numOfSlots = numOfSlots;
+   ring.header->maxWidth = maxWidth;
+   ring.header->maxHeight = maxHeight;
+   ring.header->channels = channels;
+   ring.header->slotSize = slotSize;
+   ring.header->writeCount = 0;
+   ring.header->readCount = 0;
+   ring.header->producerDone = 0;
+   sem_init(&ring.header->freeSlots, 1, numOfSlots);
+   sem_init(&ring.header->fullSlots, 1, 0);
+   __sync_synchronize();
+   ring.header->magic = FRAME_RING_MAGIC; // last => consumer sees a ready ring
+   return 0;
+}
+
+/**
+ * @brief Consumer: opens the ring created by the producer, waits (up to
+ *        timeout seconds, forever if timeout <= 0) for the producer to
+ *        create it and later for every frame. Returns 0 on success.
+ **/
+inline int FrameRingOpen(FrameRing &ring, const std::string &name, const int timeout) {
+   ring.name = (name[0] == '/') ? name : "/" + name;
+   ring.owner = false;
+   ring.timeout = timeout;
+   ring.fd = -1;
+   for (int waited = 0; ring.fd < 0; waited++) {
+      ring.fd = shm_open(ring.name.c_str(), O_RDWR, 0600);
+      if (ring.fd < 0) {
+         if (FrameRingTimedOut(waited, timeout)) {
+            std::cerr << "Cannot open shared memory " << ring.name << ": " << strerror(errno) << std::endl;
+            return -1;
+         }
+         sleep(1);
+      }
+   }
+   struct stat ringStat;
+   for (int waited = 0; ; waited++) {
+      if (fstat(ring.fd, &ringStat) != 0) {
+         std::cerr << "Cannot stat shared memory " << ring.name << ": " << strerror(errno) << std::endl;
+         close(ring.fd);
+         return -1;
+      }
+      if (ringStat.st_size >= FRAME_RING_HEADER_SIZE)
+         break;
+      if (FrameRingTimedOut(waited, timeout)) {
+         std::cerr << "Shared memory " << ring.name << " was not allocated by the producer" << std::endl;
+         close(ring.fd);
+         return -1;
+      }
+      sleep(1); // producer has not yet ftruncated
+   }
+   ring.size = ringStat.st_size;
+   void *base = mmap(NULL, ring.size, PROT_READ | PROT_WRITE, MAP_SHARED, ring.fd, 0);
+   if (base == MAP_FAILED) {
+      std::cerr << "Cannot map shared memory " << ring.name << ": " << strerror(errno) << std::endl;
+      close(ring.fd);
+      return -1;
+   }
+   ring.base = static_cast<unsigned char *>(base);
+   ring.header = reinterpret_cast<FrameRingHeader *>(ring.base);
+   for (int waited = 0; *(volatile uint32_t *)&ring.header->magic != FRAME_RING_MAGIC; waited++) {
+      if (FrameRingTimedOut(waited, timeout)) {
+         std::cerr << "Shared memory " << ring.name << " is not a frame ring" << std::endl;
+         munmap(ring.base, ring.size);
+         close(ring.fd);
+         return -1;
+      }
+      sleep(1);
+   }
+   __sync_synchronize();
+   if (ring.header->version != FRAME_RING_VERSION) {
+      std::cerr << "Frame ring version " << ring.header->version << " not supported" << std::endl;
+      munmap(ring.base, ring.size);
+      close(ring.fd);
+      return -1;
+   }
+   return 0;
+}
+
+/**
+ * @brief Producer: waits for a free slot (backpressure) and returns it,
+ *        NULL if no slot was freed within the timeout (no consumer)
+ **/
+inline FrameRingSlot *FrameRingAcquireWrite(FrameRing &ring) {
+   if (FrameRingSemWait(&ring.header->freeSlots, ring.timeout) != 0) {
+      std::cerr << "No consumer read frame " << ring.header->readCount << " of " << ring.name
+                << " within " << ring.timeout << " s: " << strerror(errno) << std::endl;
+      return NULL;
+   }
+   FrameRingSlot *slot = FrameRingSlotAt(ring, ring.header->writeCount);
+   slot->frameIndex = ring.header->writeCount;
+   return slot;
+}
+
+/**
+ * @brief Producer: publishes the slot returned by FrameRingAcquireWrite()
+ **/
+inline void FrameRingCommitWrite(FrameRing &ring) {
+   __sync_synchronize();
+   ring.header->writeCount++;
+   sem_post(&ring.header->fullSlots);
+}
+
+/**
+ * @brief Producer: no more frames (wakes up a waiting consumer)
+ **/
+inline void FrameRingFinish(FrameRing &ring) {
+   ring.header->producerDone = 1;
+   __sync_synchronize();
+   sem_post(&ring.header->fullSlots);
+}
+
+/**
+ * @brief Consumer: waits for the next frame, NULL when the producer is done
+ *        or no frame came within the timeout
+ **/
+inline FrameRingSlot *FrameRingAcquireRead(FrameRing &ring) {
+   if (FrameRingSemWait(&ring.header->fullSlots, ring.timeout) != 0) {
+      std::cerr << "No frame " << ring.header->readCount << " from " << ring.name
+                << " within " << ring.timeout << " s: " << strerror(errno) << std::endl;
+      return NULL;
+   }
+   __sync_synchronize();
+   if (ring.header->readCount >= ring.header->writeCount) {
+      // woken by FrameRingFinish()
+      return NULL;
+   }
+   return FrameRingSlotAt(ring, ring.header->readCount);
+}
+
+/**
+ * @brief Consumer: gives the slot returned by FrameRingAcquireRead() back
+ **/
+inline void FrameRingReleaseRead(FrameRing &ring) {
+   __sync_synchronize();
+   ring.header->readCount++;
+   sem_post(&ring.header->freeSlots);
+}
+
+/**
+ * @brief Unmaps the ring. The consumer removes the object after the
+ *        producer is done (a late consumer can still read the last frames
+ *        and a stale ring is removed by the next FrameRingCreate()).
+ *        remove forces the removal, e.g. when the peer is gone.
+ **/
+inline void FrameRingClose(FrameRing &ring, const bool remove_ = false) {
+   const bool remove = remove_ || (!ring.owner && ring.header->producerDone &&
+                                   ring.header->readCount >= ring.header->writeCount);
+   munmap(ring.base, ring.size);
+   close(ring.fd);
+   if (remove)
+      shm_unlink(ring.name.c_str());
+}
+
+#endif /* FRAME_RING_H */
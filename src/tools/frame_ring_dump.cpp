@@ -0,0 +1,142 @@
+/*
+ * @brief Example consumer of the render_stereo_pair frame stream.
+ *
+ * Reads the stereo frames published by render_stereo_pair --stream_output
+ * from the shared memory ring (see frame_ring.h) and reports the frame
+ * rate. Optionally every frame is dumped to the given directory as binary
+ * PPM images and a calibration file (the _CoViS_canonic format) for
+ * checking the stream. A primitive extractor reading the stream directly
+ * works the same way (FrameRingOpen, FrameRingAcquireRead, use the slot,
+ * FrameRingReleaseRead).
+ *
+ * Copyright (c)
+ *      Cognitive Vision Laboratory, SDU <norbert@mmmi.sdu.dk>
+ *      Joni Kamarainen <Joni.Kamarainen@lut.fi>
+ */
+
+/* -*- c-file-style: "bsd" -*- */
+
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <sys/time.h>
+
+#include "frame_ring.h"
+
+// internal functions
+void WritePPM(const unsigned char *pixels, const int width, const int height,
+              const int channels, const bool bottomUp, const std::string &fileName);
+void WriteCalibration(const FrameRingSlot *slot, const std::string &fileName);
+std::string BaseName(const std::string &fileName);
+
+/**
+ * @brief main
+ **/
+int main ( int argc, char *argv[] ) {
+
+   if (argc < 2) {
+      std::cout << "Usage: " << argv[0] << " <stream_name> [<dump_dir>] [<timeout_s>]" << std::endl;
+      std::cout << "       (timeout_s: wait for the producer, default 60, 0 waits forever)" << std::endl;
+      std::cout << "Example: " << argv[0] << " render_stream" << std::endl;
+      std::cout << "         (and then render_stereo_pair ... --stream_output render_stream)" << std::endl;
+      return EXIT_FAILURE;
+   }
+   std::string dumpDir;
+   if (argc > 2)
+      dumpDir = argv[2];
+   const int timeout = (argc > 3) ? atoi(argv[3]) : 60;
+
+   FrameRing ring;
+   if (FrameRingOpen(ring, argv[1], timeout)) {
+      return EXIT_FAILURE;
+   }
+   std::cout << "Stream " << ring.name << ": " << ring.header->numOfSlots << " slots of "
+             << ring.header->maxWidth << "x" << ring.header->maxHeight << "x"
+             << ring.header->channels << std::endl;
+
+   long numOfFrames = 0;
+   struct timeval startTime, endTime;
+   gettimeofday(&startTime, NULL);
+   FrameRingSlot *slot;
+   while ((slot = FrameRingAcquireRead(ring)) != NULL) {
+      std::cout << "Frame " << slot->frameIndex << ": " << slot->name << " ("
+                << slot->width << "x" << slot->height << ", fx " << slot->K_l[0][0]
+                << ", baseline " << slot->t_l[0] - slot->t_r[0] << ")" << std::endl;
+      if (!dumpDir.empty() && slot->width > 0) {
+         std::string base = dumpDir + "/" + BaseName(slot->name);
+         WritePPM(FrameRingLeftPixels(slot), slot->width, slot->height, slot->channels,
+                  slot->originBottomLeft != 0, base + "_left.ppm");
+         WritePPM(FrameRingRightPixels(slot), slot->width, slot->height, slot->channels,
+                  slot->originBottomLeft != 0, base + "_right.ppm");
+         WriteCalibration(slot, base + "_CoViS_canonic.dat");
+      }
+      FrameRingReleaseRead(ring);
+      numOfFrames++;
+   }
+   gettimeofday(&endTime, NULL);
+   const double elapsed = (endTime.tv_sec - startTime.tv_sec) +
+      (endTime.tv_usec - startTime.tv_usec) / 1e6;
+   std::cout << numOfFrames << " stereo frames in " << elapsed << " s ("
+             << numOfFrames / elapsed << " frames/s)" << std::endl;
+
+   // Stopped by the timeout if the producer did not finish (dead producer)
+   const bool producerDone = ring.header->producerDone != 0;
+   FrameRingClose(ring, !producerDone);
+   return producerDone ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Writes a binary PPM (top-down rows, first channels only if not RGB)
+ **/
+void WritePPM(const unsigned char *pixels, const int width, const int height,
+              const int channels, const bool bottomUp, const std::string &fileName) {
+   std::ofstream fd(fileName.data(), std::ios::binary);
+   fd << "P6\n" << width << " " << height << "\n255\n";
+   for (int row = 0; row < height; row++) {
+      const int srcRow = bottomUp ? height - 1 - row : row;
+      const unsigned char *rowPixels = pixels + (size_t)srcRow * width * channels;
+      for (int col = 0; col < width; col++)
+         for (int ch = 0; ch < 3; ch++)
+            fd.put(rowPixels[col * channels + ((ch < channels) ? ch : 0)]);
+   }
+   fd.close();
+}
+
+/**
+ * @brief Writes the slot calibration as SaveStereoCalibrationOpenCV() in
+ *        render_stereo_pair (no lens distortion)
+ **/
+void WriteCalibration(const FrameRingSlot *slot, const std::string &fileName) {
+   std::ofstream fd(fileName.data());
+   fd << "2" << std::endl << std::endl;
+   for (int cam = 0; cam < 2; cam++) {
+      const double (*K)[3] = (cam == 0) ? slot->K_l : slot->K_r;
+      const double (*R)[3] = (cam == 0) ? slot->R_l : slot->R_r;
+      const double *t = (cam == 0) ? slot->t_l : slot->t_r;
+      fd << slot->width << " " << slot->height << std::endl;
+      for (int i = 0; i < 3; i++)
+         fd << K[i][0] << " " << K[i][1] << " " << K[i][2] << std::endl;
+      fd << "0 0 0 0" << std::endl;
+      for (int i = 0; i < 3; i++)
+         fd << R[i][0] << " " << R[i][1] << " " << R[i][2] << std::endl;
+      fd << t[0] << " " << t[1] << " " << t[2] << std::endl;
+      if (cam == 0)
+         fd << std::endl;
+   }
+   fd.close();
+}
+
+/**
+ * @brief File name without the directory and extension
+ **/
+std::string BaseName(const std::string &fileName) {
+   std::string base = fileName;
+   size_t dirEnd = base.rfind("/");
+   if (dirEnd != std::string::npos)
+      base.erase(0, dirEnd + 1);
+   size_t extStart = base.rfind(".");
+   if (extStart != std::string::npos)
+      base.erase(extStart);
+   return base;
+}
@@ -0,0 +1,312 @@
+/*
+ * @brief Benchmark of the level-of-detail (LOD) meshes: rendering speed
+ *        (frames/s) against the image difference to the full mesh.
+ *
+ * Renders the given model with every mesh level at a few camera distances
+ * and prints, for every distance and level, the frame rate, the mean
+ * absolute pixel difference to the full mesh image and which level
+ * render_stereo_pair would select (marked with '*').
+ *
+ * Copyright (c)
+ *      Cognitive Vision Laboratory, SDU <norbert@mmmi.sdu.dk>
+ *      Joni Kamarainen <Joni.Kamarainen@lut.fi>
+ */
+
+/* -*- c-file-style: "bsd" -*- */
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <vtkmetaio/metaCommand.h>
+#include <vtkSmartPointer.h>
+#include <vtkPNGReader.h>
+#include <vtkImageData.h>
+#include <vtkTexture.h>
+#include <vtkRenderer.h>
+#include <vtkRenderWindow.h>
+#include <vtkActor.h>
+#include <vtkOBJReader.h>
+#include <vtkCamera.h>
+#include <vtkWindowToImageFilter.h>
+#include <vtkTimerLog.h>
+
+#include "lod_mesh.h"
+#include "camera_geometry.h"
+
+using std::isnan;
+
+// internal functions
+void GrabImage(vtkWindowToImageFilter *imageFilter, std::vector<unsigned char> &img);
+double MeanAbsDiff(const std::vector<unsigned char> &img1,
+                   const std::vector<unsigned char> &img2);
+int MainParseCommandLine( vtkmetaio::MetaCommand& command,
+                          int argc, char **const argv);
+
+/**
+ * @brief main
+ **/
+int main ( int argc, char *argv[] ) {
+
+   vtkmetaio::MetaCommand command;
+   if (MainParseCommandLine(command, argc, argv)) {
+      return EXIT_FAILURE;
+   }
+   const int numOfFrames = command.GetValueAsInt("frames", "num");
+
+   // Model, texture and the mesh levels
+   vtkSmartPointer<vtkOBJReader> reader =
+      vtkSmartPointer<vtkOBJReader>::New();
+   reader->SetFileName(command.GetValueAsString("model", "file").c_str());
+   reader->Update();
+   std::string lodCacheDir;
+   if (command.GetOptionWasSet("lod_cache_dir"))
+      lodCacheDir = command.GetValueAsString("lod_cache_dir", "dir");
+   LODMesh lod;
+   double buildStart = vtkTimerLog::GetUniversalTime();
+   if (BuildLODMesh(reader->GetOutput(), command.GetValueAsString("model", "file"),
+                    command.GetValueAsInt("lod_levels", "levels"), lodCacheDir, lod)) {
+      return EXIT_FAILURE;
+   }
+   cout << "Mesh levels built/read in " << vtkTimerLog::GetUniversalTime() - buildStart
+        << " s" << std::endl;
+
+   vtkSmartPointer<vtkPNGReader> pNGReader =
+      vtkSmartPointer<vtkPNGReader>::New();
+   vtkSmartPointer<vtkTexture> texture =
+      vtkSmartPointer<vtkTexture>::New();
+   if (command.GetOptionWasSet("texture")) {
+      pNGReader->SetFileName (command.GetValueAsString("texture", "file").c_str());
+      texture->SetInput(pNGReader->GetOutput());
+   }
+
+   // Object centred as in render_stereo_pair
+   vtkSmartPointer<vtkActor> texturedQuad =
+      vtkSmartPointer<vtkActor>::New();
+   texturedQuad->SetMapper(lod.mappers[0]);
+   texturedQuad->SetTexture(texture);
+   texturedQuad->SetOrientation(command.GetValueAsFloat("objorientation", "x"),
+                                command.GetValueAsFloat("objorientation", "y"),
+                                command.GetValueAsFloat("objorientation", "z"));
+   double *quadCenter = texturedQuad->GetCenter();
+   texturedQuad->SetPosition(-quadCenter[0], -quadCenter[1], -quadCenter[2]);
+   double bounds[6];
+   texturedQuad->GetBounds(bounds);
+
+   vtkSmartPointer<vtkRenderer> renderer =
+      vtkSmartPointer<vtkRenderer>::New();
+   renderer->AddActor(texturedQuad);
+   vtkSmartPointer<vtkRenderWindow> renderWindow =
+      vtkSmartPointer<vtkRenderWindow>::New();
+   renderWindow->SetOffScreenRendering(1);
+   renderWindow->AddRenderer(renderer);
+   const int sz[2] = {command.GetValueAsInt("image_size", "width"),
+                      command.GetValueAsInt("image_size", "height")};
+   renderWindow->SetSize(sz[0], sz[1]);
+   vtkSmartPointer<vtkWindowToImageFilter> imageFilter =
+      vtkSmartPointer<vtkWindowToImageFilter>::New();
+   imageFilter->SetInput(renderWindow);
+
+   vtkCamera *camera = vtkCamera::New();
+   camera->ParallelProjectionOff();
+   camera->SetViewAngle(command.GetValueAsFloat("view_angle", "angle"));
+   renderer->SetActiveCamera(camera);
+   renderer->ResetCamera();
+
+   // Intrinsic matrix as in CanonicStereoCameraMatrix_CoViS()
+   const double fov = camera->GetViewAngle();
+   const CamK K = CamKFromViewAngle(sz, fov);
+
+   // Camera distances relative to the automatic distance of render_stereo_pair
+   const double bbDiagonal = sqrt((bounds[1] - bounds[0]) * (bounds[1] - bounds[0]) +
+                                  (bounds[3] - bounds[2]) * (bounds[3] - bounds[2]) +
+                                  (bounds[5] - bounds[4]) * (bounds[5] - bounds[4]));
+   const double autoDistance = 1.1 * bbDiagonal / 2 / tan(fov * M_PI / 180 / 2);
+   float distScale[5];
+   distScale[0] = command.GetValueAsFloat("distance_scale", "val1");
+   distScale[1] = command.GetValueAsFloat("distance_scale", "val2");
+   distScale[2] = command.GetValueAsFloat("distance_scale", "val3");
+   distScale[3] = command.GetValueAsFloat("distance_scale", "val4");
+   distScale[4] = command.GetValueAsFloat("distance_scale", "val5");
+
+   std::ofstream resFile;
+   if (command.GetOptionWasSet("output"))
+      resFile.open(command.GetValueAsString("output", "file").data());
+   char resLine[256];
+   sprintf(resLine, "%8s %6s %10s %10s %10s %4s", "distance", "level", "triangles",
+           "frames/s", "imgdiff", "sel");
+   cout << resLine << std::endl;
+   if (resFile.is_open())
+      resFile << "#" << resLine << std::endl;
+
+   std::vector<unsigned char> fullImg, levelImg;
+   for (int dind = 0; dind < 5; dind++) {
+      if (isnan(distScale[dind])) {
+         continue;
+      }
+      camera->SetPosition(0, 0, -distScale[dind] * autoDistance);
+      renderer->ResetCameraClippingRange();
+
+      // Level selected from the projected bounding box
+      double bbox[3][8], bbox_view[3][8];
+      for (int bbi = 0; bbi < 8; bbi++) {
+         bbox[0][bbi] = bounds[(bbi & 1) ? 1 : 0];
+         bbox[1][bbi] = bounds[(bbi & 2) ? 3 : 2];
+         bbox[2][bbi] = bounds[(bbi & 4) ? 5 : 4];
+      }
+      CamR viewR;
+      CamT viewT;
+      CamRtFromMatrix4x4(camera->GetViewTransformMatrix()->Element, viewR, viewT);
+      CamTransformPoints(viewR, viewT, bbox[0], bbox[1], bbox[2], 8,
+                         bbox_view[0], bbox_view[1], bbox_view[2]);
+      const int selLevel = SelectLODLevel(lod, ProjectedBBoxArea(bbox_view, K),
+                                          command.GetValueAsFloat("lod_pixels_per_triangle", "pixels"));
+
+      for (size_t level = 0; level < lod.mappers.size(); level++) {
+         texturedQuad->SetMapper(lod.mappers[level]);
+         renderWindow->Render(); // warm up (display lists, textures)
+
+         double startTime = vtkTimerLog::GetUniversalTime();
+         for (int fi = 0; fi < numOfFrames; fi++) {
+            texturedQuad->Modified();
+            renderWindow->Render();
+         }
+         double fps = numOfFrames / (vtkTimerLog::GetUniversalTime() - startTime);
+
+         if (level == 0) {
+            GrabImage(imageFilter, fullImg);
+            levelImg = fullImg;
+         } else {
+            GrabImage(imageFilter, levelImg);
+         }
+
+         sprintf(resLine, "%8.2f %6d %10ld %10.1f %10.4f %4s", distScale[dind], (int)level,
+                 lod.numOfTriangles[level], fps, MeanAbsDiff(fullImg, levelImg),
+                 ((int)level == selLevel) ? "*" : "");
+         cout << resLine << std::endl;
+         if (resFile.is_open())
+            resFile << " " << resLine << std::endl;
+      }
+   }
+   if (resFile.is_open())
+      resFile.close();
+
+   return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Copies the current render window content (RGB) to img.
+ **/
+void GrabImage(vtkWindowToImageFilter *imageFilter, std::vector<unsigned char> &img) {
+   imageFilter->Modified(); // kludge as this filter sucks
+   imageFilter->Update();
+   vtkImageData *imgData = imageFilter->GetOutput();
+   int dims[3];
+   imgData->GetDimensions(dims);
+   const size_t numOfBytes = (size_t)dims[0] * dims[1] * imgData->GetNumberOfScalarComponents();
+   const unsigned char *pixels = static_cast<unsigned char *>(imgData->GetScalarPointer());
+   img.assign(pixels, pixels + numOfBytes);
+}
+
+/**
+ * @brief Mean absolute difference of two 8-bit images (per channel value).
+ **/
+double MeanAbsDiff(const std::vector<unsigned char> &img1,
+                   const std::vector<unsigned char> &img2) {
+   if (img1.size() != img2.size() || img1.empty())
+      return HUGE_VAL;
+   double diffSum = 0;
+   for (size_t pi = 0; pi < img1.size(); pi++)
+      diffSum += std::abs((int)img1[pi] - (int)img2[pi]);
+   return diffSum / img1.size();
+}
+
+/**
+ * @brief Help provided for a user
+ **/
+void MainHelpCallBack(void) {
+   cout << std::endl;
+   cout << "A program to benchmark the mesh levels of detail used by render_stereo_pair." << std::endl;
+   cout << std::endl;
+   cout << "For every camera distance and mesh level the rendering speed (frames/s) and" << std::endl;
+   cout << "the mean absolute difference to the full mesh image are printed. The level" << std::endl;
+   cout << "render_stereo_pair would select is marked by '*'." << std::endl;
+   cout << std::endl;
+   return;
+}
+
+/**
+ * @brief Command line parsing (using vtkmeatio::MetaCommand since VTK needed anyway).
+ *        See http://www.vtk.org/Wiki/MetaIO/MetaCommand_Documentation
+ **/
+int MainParseCommandLine( vtkmetaio::MetaCommand& command,
+                          int argc, char **const argv) {
+   command.SetHelpCallBack(MainHelpCallBack);
+   command.SetDescription("A program to benchmark the mesh levels of detail used by render_stereo_pair.");
+   command.SetAuthor("Joni Kamarainen <Joni.Kamarainen@lut.fi>");
+
+   command.SetOption("model", "", true, "Model file (OBJ format supported).");
+   command.SetOptionLongTag("model", "model");
+   command.AddOptionField("model", "file", vtkmetaio::MetaCommand::STRING, true);
+
+   command.SetOption("texture", "", false, "Texture file (PNG supported).");
+   command.SetOptionLongTag("texture", "texture");
+   command.AddOptionField("texture", "file", vtkmetaio::MetaCommand::STRING, true);
+
+   command.SetOption("output", "", false, "File where the results are written (in addition to stdout).");
+   command.SetOptionLongTag("output", "output");
+   command.AddOptionField("output", "file", vtkmetaio::MetaCommand::STRING, true);
+
+   command.SetOption("image_size", "", false, "Size of the rendered image.");
+   command.SetOptionLongTag("image_size", "image_size");
+   command.AddOptionField("image_size", "height",
+                          vtkmetaio::MetaCommand::INT, true, "300");
+   command.AddOptionField("image_size", "width",
+                          vtkmetaio::MetaCommand::INT, true, "300");
+
+   command.SetOption("view_angle", "", false, "Camera view angle.");
+   command.SetOptionLongTag("view_angle", "view_angle");
+   command.AddOptionField("view_angle", "angle",
+                          vtkmetaio::MetaCommand::FLOAT, true, "40");
+
+   command.SetOption("objorientation", "", false, "Object orientation angles along its own axes.");
+   command.SetOptionLongTag("objorientation", "objorientation");
+   command.AddOptionField("objorientation", "x", vtkmetaio::MetaCommand::FLOAT, true, "0.0");
+   command.AddOptionField("objorientation", "y", vtkmetaio::MetaCommand::FLOAT, true, "+90.0");
+   command.AddOptionField("objorientation", "z", vtkmetaio::MetaCommand::FLOAT, true, "0.0");
+
+   command.SetOption("frames", "", false, "Number of frames rendered per distance and level.");
+   command.SetOptionLongTag("frames", "frames");
+   command.AddOptionField("frames", "num", vtkmetaio::MetaCommand::INT, true, "100");
+
+   command.SetOption("lod_levels", "", false, "Number of mesh levels of detail.");
+   command.SetOptionLongTag("lod_levels", "lod_levels");
+   command.AddOptionField("lod_levels", "levels",
+                          vtkmetaio::MetaCommand::INT, true, "5");
+
+   command.SetOption("lod_pixels_per_triangle", "", false, "Level selection threshold as in render_stereo_pair.");
+   command.SetOptionLongTag("lod_pixels_per_triangle", "lod_pixels_per_triangle");
+   command.AddOptionField("lod_pixels_per_triangle", "pixels",
+                          vtkmetaio::MetaCommand::FLOAT, true, "2.0");
+
+   command.SetOption("lod_cache_dir", "", false, "Directory for the cached mesh levels (default: the model directory).");
+   command.SetOptionLongTag("lod_cache_dir", "lod_cache_dir");
+   command.AddOptionField("lod_cache_dir", "dir", vtkmetaio::MetaCommand::STRING, true);
+
+   command.SetOption("distance_scale", "", false, "Camera distances as multiples of the automatic distance of render_stereo_pair (upto 5 values, use \"nan\" to omit).");
+   command.SetOptionLongTag("distance_scale", "distance_scale");
+   command.AddOptionField("distance_scale", "val1", vtkmetaio::MetaCommand::FLOAT, false, "1.0");
+   command.AddOptionField("distance_scale", "val2", vtkmetaio::MetaCommand::FLOAT, false, "2.0");
+   command.AddOptionField("distance_scale", "val3", vtkmetaio::MetaCommand::FLOAT, false, "4.0");
+   command.AddOptionField("distance_scale", "val4", vtkmetaio::MetaCommand::FLOAT, false, "8.0");
+   command.AddOptionField("distance_scale", "val5", vtkmetaio::MetaCommand::FLOAT, false, "nan");
+
+   if ( !command.Parse(argc, argv) ) {
+      cout << "Example: " << command.GetApplicationName() << " --model testdata/OrangeMarmelade_800_tex.obj --texture testdata/OrangeMarmelade_800_tex.png --lod_cache_dir ." << std::endl;
+      return -1;
+   }
+   return 0;
+}
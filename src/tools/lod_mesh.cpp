@@ -0,0 +1,181 @@
+/*
+ * @brief Level-of-detail (LOD) meshes for view distance aware rendering.
+ *        See lod_mesh.h for details.
+ *
+ * Copyright (c)
+ *      Cognitive Vision Laboratory, SDU <norbert@mmmi.sdu.dk>
+ *      Joni Kamarainen <Joni.Kamarainen@lut.fi>
+ */
+
+/* -*- c-file-style: "bsd" -*- */
+
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+
+#include <vtkTriangleFilter.h>
+#include <vtkQuadricDecimation.h>
+#include <vtkXMLPolyDataReader.h>
+#include <vtkXMLPolyDataWriter.h>
+
+#include "lod_mesh.h"
+
+/**
+ * @brief Cache file name of a LOD level, e.g.,
+ *        "dir/OrangeMarmelade_5k_tex.obj" => "dir/OrangeMarmelade_5k_tex_lod2.vtp"
+ *        or the same base name in cacheDir if it is given.
+ **/
+static std::string LODCacheFilename(const std::string &modelFile,
+                                    const std::string &cacheDir, const int level) {
+   std::string base = modelFile;
+   size_t extStart = base.rfind(".");
+   size_t dirEnd = base.rfind("/");
+   if (extStart != std::string::npos && (dirEnd == std::string::npos || extStart > dirEnd))
+      base.erase(extStart);
+   if (!cacheDir.empty()) {
+      if (dirEnd != std::string::npos)
+         base.erase(0, dirEnd + 1);
+      base = cacheDir + "/" + base;
+   }
+   std::ostringstream fileName;
+   fileName << base << "_lod" << level << ".vtp";
+   return fileName.str();
+}
+
+/**
+ * @brief True if the cache file exists and is not older than the model.
+ **/
+static bool LODCacheValid(const std::string &cacheFile, const std::string &modelFile) {
+   struct stat cacheStat, modelStat;
+   if (stat(cacheFile.data(), &cacheStat) != 0)
+      return false;
+   if (stat(modelFile.data(), &modelStat) != 0)
+      return true; // model not a file (e.g. generated), trust the cache
+   return cacheStat.st_mtime >= modelStat.st_mtime;
+}
+
+/**
+ * @brief Builds (or reads from the cache) numOfLevels mesh levels of the
+ *        given full mesh. Level l is decimated from the full mesh to 0.5^l
+ *        of its triangles by quadric simplification where the texture
+ *        coordinates are part of the error metric (ref. [1] in lod_mesh.h).
+ *        Returns 0 on success.
+ **/
+int BuildLODMesh(vtkPolyData *fullMesh, const std::string &modelFile,
+                 const int numOfLevels, const std::string &cacheDir,
+                 LODMesh &lod) {
+   lod.levels.clear();
+   lod.mappers.clear();
+   lod.numOfTriangles.clear();
+
+   // Decimation works for triangles only (OBJ may have quads)
+   vtkSmartPointer<vtkTriangleFilter> triangleFilter =
+      vtkSmartPointer<vtkTriangleFilter>::New();
+   triangleFilter->SetInput(fullMesh);
+   triangleFilter->Update();
+   vtkSmartPointer<vtkPolyData> fullTriangles =
+      vtkSmartPointer<vtkPolyData>::New();
+   fullTriangles->ShallowCopy(triangleFilter->GetOutput());
+
+   for (int level = 0; level < numOfLevels; level++) {
+      vtkSmartPointer<vtkPolyData> levelMesh =
+         vtkSmartPointer<vtkPolyData>::New();
+      if (level == 0) {
+         levelMesh->ShallowCopy(fullTriangles);
+      } else {
+         std::string cacheFile = LODCacheFilename(modelFile, cacheDir, level);
+         if (LODCacheValid(cacheFile, modelFile)) {
+            vtkSmartPointer<vtkXMLPolyDataReader> cacheReader =
+               vtkSmartPointer<vtkXMLPolyDataReader>::New();
+            cacheReader->SetFileName(cacheFile.c_str());
+            cacheReader->Update();
+            levelMesh->ShallowCopy(cacheReader->GetOutput());
+         } else {
+            vtkSmartPointer<vtkQuadricDecimation> decimator =
+               vtkSmartPointer<vtkQuadricDecimation>::New();
+            decimator->SetInput(fullTriangles);
+            decimator->SetTargetReduction(1.0 - std::pow(0.5, level));
+            decimator->AttributeErrorMetricOn();
+            decimator->ScalarsAttributeOff();
+            decimator->VectorsAttributeOff();
+            decimator->NormalsAttributeOff();
+            decimator->TensorsAttributeOff();
+            decimator->SetTCoordsAttribute(1);
+            decimator->SetTCoordsWeight(1.0);
+            decimator->Update();
+            levelMesh->ShallowCopy(decimator->GetOutput());
+
+            vtkSmartPointer<vtkXMLPolyDataWriter> cacheWriter =
+               vtkSmartPointer<vtkXMLPolyDataWriter>::New();
+            cacheWriter->SetInput(levelMesh);
+            cacheWriter->SetFileName(cacheFile.c_str());
+            cacheWriter->SetDataModeToBinary();
+            if (!cacheWriter->Write())
+               std::cout << "[NOTE] Cannot write LOD cache " << cacheFile << std::endl;
+         }
+      }
+      if (levelMesh->GetNumberOfPolys() == 0) {
+         std::cerr << "LOD level " << level << " of " << modelFile << " is empty!" << std::endl;
+         return -1;
+      }
+
+      vtkSmartPointer<vtkPolyDataMapper> mapper =
+         vtkSmartPointer<vtkPolyDataMapper>::New();
+      mapper->SetInput(levelMesh);
+      lod.levels.push_back(levelMesh);
+      lod.mappers.push_back(mapper);
+      lod.numOfTriangles.push_back(levelMesh->GetNumberOfPolys());
+   }
+   return 0;
+}
+
+/**
+ * @brief Area (in pixels) of the image rectangle covered by the bounding box
+ *        given in the VTK camera frame (camera looks toward negative z).
+ *        Projection by P = K[R|0] where R turns the VTK camera frame to the
+ *        CoViS one (see camera_geometry.h). Returns infinity if the box is
+ *        (partly) behind the camera.
+ **/
+double ProjectedBBoxArea(const double bbox_view[][8], const CamK &K) {
+   CamR R = CamRIdentity();
+   CamT t = {{0, 0, 0}};
+   CamConvertRt(CAM_VTK, CAM_COVIS, R, t);
+   double u[8], v[8], depth[8];
+   CamProjectPoints(CamComposeP(K, R, t), bbox_view[0], bbox_view[1], bbox_view[2], 8,
+                    u, v, depth);
+   double umin = HUGE_VAL, umax = -HUGE_VAL;
+   double vmin = HUGE_VAL, vmax = -HUGE_VAL;
+   for (int bbi = 0; bbi < 8; bbi++) {
+      if (depth[bbi] <= 0)
+         return HUGE_VAL;
+      umin = std::min(umin, u[bbi]);
+      umax = std::max(umax, u[bbi]);
+      vmin = std::min(vmin, v[bbi]);
+      vmax = std::max(vmax, v[bbi]);
+   }
+   // Only the visible part of the box matters
+   umin = std::max(umin, 0.0);
+   vmin = std::max(vmin, 0.0);
+   umax = std::min(umax, 2 * K.m[0][2]);
+   vmax = std::min(vmax, 2 * K.m[1][2]);
+   if (umax <= umin || vmax <= vmin)
+      return 0;
+   return (umax - umin) * (vmax - vmin);
+}
+
+/**
+ * @brief Selects the coarsest level whose (front facing, roughly half)
+ *        triangles still are at most pixelsPerTriangle pixels in the image,
+ *        i.e. decimation removes only triangles that would be sub-pixel anyway.
+ **/
+int SelectLODLevel(const LODMesh &lod, const double projectedArea,
+                   const double pixelsPerTriangle) {
+   const double neededTriangles = 2 * projectedArea / pixelsPerTriangle;
+   for (int level = (int)lod.numOfTriangles.size() - 1; level > 0; level--) {
+      if (lod.numOfTriangles[level] >= neededTriangles)
+         return level;
+   }
+   return 0;
+}
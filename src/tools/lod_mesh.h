@@ -0,0 +1,55 @@
+/*
+ * @brief Level-of-detail (LOD) meshes for view distance aware rendering.
+ *
+ * The decimated levels are produced offline by quadric simplification
+ * (vtkQuadricDecimation) with the texture coordinates included in the
+ * error metric so that the textures stay in place. The levels are cached
+ * as VTK XML poly data files next to the model (or to a given directory)
+ * and a level is selected per view from the projected size of the
+ * bounding box in pixels (computed with the intrinsic camera matrix K).
+ *
+ * Copyright (c)
+ *      Cognitive Vision Laboratory, SDU <norbert@mmmi.sdu.dk>
+ *      Joni Kamarainen <Joni.Kamarainen@lut.fi>
+ *
+ * References:
+ *  [1] Garland, M. and Heckbert, P.S., Simplifying Surfaces with Color and
+ *      Texture using Quadric Error Metrics, IEEE Visualization, 1998.
+ *  [2] Hartley, R., and Zisserman, A., Multiple View Geometry in Computer
+ *      Vision, 2003.
+ */
+
+/* -*- c-file-style: "bsd" -*- */
+
+#ifndef LOD_MESH_H
+#define LOD_MESH_H
+
+#include <string>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataMapper.h>
+
+#include "camera_geometry.h"
+
+/**
+ * @brief Mesh levels of one model, level 0 is the full mesh and every
+ *        next level has roughly half of the triangles of the previous.
+ *        One mapper per level so that instances of the same model can
+ *        share the levels.
+ **/
+struct LODMesh {
+   std::vector<vtkSmartPointer<vtkPolyData> > levels;
+   std::vector<vtkSmartPointer<vtkPolyDataMapper> > mappers;
+   std::vector<long> numOfTriangles;
+};
+
+int BuildLODMesh(vtkPolyData *fullMesh, const std::string &modelFile,
+                 const int numOfLevels, const std::string &cacheDir,
+                 LODMesh &lod);
+double ProjectedBBoxArea(const double bbox_view[][8], const CamK &K);
+int SelectLODLevel(const LODMesh &lod, const double projectedArea,
+                   const double pixelsPerTriangle);
+
+#endif /* LOD_MESH_H */
@@ -20,7 +20,12 @@
 /* -*- c-file-style: "bsd" -*- */
 
 #include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
 #include <cmath>
+#include <algorithm>
 
 #include <vtkmetaio/metaCommand.h>
 #include <vtkSmartPointer.h>
@@ -39,15 +44,41 @@
 #include <vtkWindowToImageFilter.h>
 #include <vtkPNGWriter.h>
 
+#include "lod_mesh.h"
+#include "camera_geometry.h"
+#include "frame_ring.h"
+
 using std::isnan;
 
+/**
+ * @brief One rendered object instance. Instances of the same model share
+ *        the mapper (poly data) and texture, only the actor (pose) is own.
+ **/
+struct SceneInstance {
+   std::string name; // used to name the bbox files (empty => no postfix)
+   vtkSmartPointer<vtkActor> actor;
+   double bbox[3][8]; // world coordinates
+   LODMesh *lod; // NULL if LOD not used
+};
+
 // internal functions
-void DisplayAndStoreStereo(vtkRenderer *renderer, vtkPNGWriter *pNGWriter,
-                           vtkWindowToImageFilter *imageFilter,
-                           const double baseLine,
-                           const std::string &cam_mat_file,
-                           const std::string &cam_img_file,
-                           const double bbox[][8], const std::string &bbox_file);
+int DisplayAndStoreStereo(vtkRenderer *renderer, vtkPNGWriter *pNGWriter,
+                          vtkWindowToImageFilter *imageFilter,
+                          const double baseLine,
+                          const std::string &cam_mat_file,
+                          const std::string &cam_img_file,
+                          const std::vector<SceneInstance> &instances,
+                          const std::string &bbox_file,
+                          const double lodPixelsPerTriangle,
+                          FrameRing *stream);
+void CopyFrameToSlot(vtkWindowToImageFilter *imageFilter, const FrameRing &ring,
+                     FrameRingSlot *slot, unsigned char *pixels);
+int LoadScene(const std::string &sceneFile, vtkRenderer *renderer,
+              const int lodLevels, const std::string &lodCacheDir,
+              std::map<std::string, LODMesh> &lodMeshes,
+              std::vector<SceneInstance> &instances);
+void BoundsToBBox(const double bounds[], double bbox[][8]);
+void WriteBBox(const double bbox[][8], const std::string &bbox_file);
 void CanonicStereoCameraMatrix_CoViS(const int sz[], const double fov,
                                      const double baseLine, const short leftView,
                                      double K[][3], double R[][3], double t[], double k[]);
@@ -76,85 +107,96 @@ int main ( int argc, char *argv[] ) {
 
    int debugMode = command.GetValueAsInt("debug_mode", "mode");
 
-   // Read obj file (-> poly data) => triangulated 3D model
-   vtkSmartPointer<vtkOBJReader> reader =
-      vtkSmartPointer<vtkOBJReader>::New();
-   reader->SetFileName(command.GetValueAsString("model", "file").c_str());
-   reader->Update();
-
-   // Map poly data to graphics => "Object"
-   vtkSmartPointer<vtkPolyDataMapper> mapper =
-      vtkSmartPointer<vtkPolyDataMapper>::New();
-   mapper->SetInputConnection(reader->GetOutputPort());
-
-   // Read the texture image => Textured object
-   vtkSmartPointer<vtkPNGReader> pNGReader =
-      vtkSmartPointer<vtkPNGReader>::New();
-   vtkSmartPointer<vtkTexture> texture =
-      vtkSmartPointer<vtkTexture>::New();
-   if (command.GetOptionWasSet("texture")) {
-      pNGReader->SetFileName (command.GetValueAsString("texture", "file").c_str());
-      texture->SetInput(pNGReader->GetOutput());
-   } else
-      cout << "[NOTE] No texture given and thus rendering shape only." << std::endl;
-
-   // Map poly data and texture to textured quads (triangles mostly) => object
-   vtkSmartPointer<vtkActor> texturedQuad =
-      vtkSmartPointer<vtkActor>::New();
-   texturedQuad->SetMapper(mapper);
-   texturedQuad->SetTexture(texture); // should appear if loaded
-
-   // Set object orientation and center it according to its bounding box (assumes no outliers)
-   texturedQuad->SetOrientation(command.GetValueAsFloat("objorientation", "x"),
-                                command.GetValueAsFloat("objorientation", "y"),
-                                command.GetValueAsFloat("objorientation", "z"));
-   double *quadCenter = texturedQuad->GetCenter();
-   texturedQuad->SetPosition(-quadCenter[0], -quadCenter[1], -quadCenter[2]);
-   double bounds[6];
-   texturedQuad->GetBounds(bounds); // store for visualisation
-
-   // Construct and store the bounding box vertex coordinates (world coordinates)
-   double bbox[3][8];
-   bbox[0][0] = bounds[0];
-   bbox[1][0] = bounds[2];
-   bbox[2][0] = bounds[4]; //(xmin,ymin,zmin)
-   bbox[0][1] = bounds[1];
-   bbox[1][1] = bounds[2];
-   bbox[2][1] = bounds[4]; //(xmax,ymin,zmin)
-   bbox[0][2] = bounds[0];
-   bbox[1][2] = bounds[3];
-   bbox[2][2] = bounds[4]; //(xmin,ymax,zmin)
-   bbox[0][3] = bounds[0];
-   bbox[1][3] = bounds[2];
-   bbox[2][3] = bounds[5]; //(xmin,ymin,zmax)
-   bbox[0][4] = bounds[1];
-   bbox[1][4] = bounds[3];
-   bbox[2][4] = bounds[4]; //(xmax,ymax,zmin)
-   bbox[0][5] = bounds[1];
-   bbox[1][5] = bounds[2];
-   bbox[2][5] = bounds[5]; //(xmax,ymin,zmax)
-   bbox[0][6] = bounds[0];
-   bbox[1][6] = bounds[3];
-   bbox[2][6] = bounds[5]; //(xmin,ymax,zmax)
-   bbox[0][7] = bounds[1];
-   bbox[1][7] = bounds[3];
-   bbox[2][7] = bounds[5]; //(xmax,ymax,zmax)
-   std::ofstream bBFile;
-   bBFile.open(AddPostDefToFilename(command.GetValueAsString("bboutput", "file"), "_vtk_world").data());
-   bBFile << bbox[0][0] << " " << bbox[1][0] << " " << bbox[2][0] << std::endl;
-   bBFile << bbox[0][1] << " " << bbox[1][1] << " " << bbox[2][1] << std::endl;
-   bBFile << bbox[0][2] << " " << bbox[1][2] << " " << bbox[2][2] << std::endl;
-   bBFile << bbox[0][3] << " " << bbox[1][3] << " " << bbox[2][3] << std::endl;
-   bBFile << bbox[0][4] << " " << bbox[1][4] << " " << bbox[2][4] << std::endl;
-   bBFile << bbox[0][5] << " " << bbox[1][5] << " " << bbox[2][5] << std::endl;
-   bBFile << bbox[0][6] << " " << bbox[1][6] << " " << bbox[2][6] << std::endl;
-   bBFile << bbox[0][7] << " " << bbox[1][7] << " " << bbox[2][7] << std::endl;
-   bBFile.close();
-
    // Setup renderer
    vtkSmartPointer<vtkRenderer> renderer =
       vtkSmartPointer<vtkRenderer>::New();
-   renderer->AddActor(texturedQuad);
+
+   // Level-of-detail meshes (one set per unique model)
+   const int lodLevels = command.GetValueAsInt("lod_levels", "levels");
+   std::string lodCacheDir;
+   if (command.GetOptionWasSet("lod_cache_dir"))
+      lodCacheDir = command.GetValueAsString("lod_cache_dir", "dir");
+   std::map<std::string, LODMesh> lodMeshes;
+
+   // Either a single object (--model) or a scene of instances (--scene)
+   std::vector<SceneInstance> instances;
+   if (command.GetOptionWasSet("scene")) {
+      if (LoadScene(command.GetValueAsString("scene", "file"), renderer,
+                    lodLevels, lodCacheDir, lodMeshes, instances)) {
+         return EXIT_FAILURE;
+      }
+   } else if (command.GetOptionWasSet("model")) {
+      // Read obj file (-> poly data) => triangulated 3D model
+      vtkSmartPointer<vtkOBJReader> reader =
+         vtkSmartPointer<vtkOBJReader>::New();
+      reader->SetFileName(command.GetValueAsString("model", "file").c_str());
+      reader->Update();
+
+      // Map poly data to graphics => "Object"
+      vtkSmartPointer<vtkPolyDataMapper> mapper =
+         vtkSmartPointer<vtkPolyDataMapper>::New();
+      mapper->SetInputConnection(reader->GetOutputPort());
+
+      // Read the texture image => Textured object
+      vtkSmartPointer<vtkPNGReader> pNGReader =
+         vtkSmartPointer<vtkPNGReader>::New();
+      vtkSmartPointer<vtkTexture> texture =
+         vtkSmartPointer<vtkTexture>::New();
+      if (command.GetOptionWasSet("texture")) {
+         pNGReader->SetFileName (command.GetValueAsString("texture", "file").c_str());
+         texture->SetInput(pNGReader->GetOutput());
+      } else
+         cout << "[NOTE] No texture given and thus rendering shape only." << std::endl;
+
+      // Map poly data and texture to textured quads (triangles mostly) => object
+      vtkSmartPointer<vtkActor> texturedQuad =
+         vtkSmartPointer<vtkActor>::New();
+      texturedQuad->SetMapper(mapper);
+      texturedQuad->SetTexture(texture); // should appear if loaded
+
+      // Set object orientation and center it according to its bounding box (assumes no outliers)
+      texturedQuad->SetOrientation(command.GetValueAsFloat("objorientation", "x"),
+                                   command.GetValueAsFloat("objorientation", "y"),
+                                   command.GetValueAsFloat("objorientation", "z"));
+      double *quadCenter = texturedQuad->GetCenter();
+      texturedQuad->SetPosition(-quadCenter[0], -quadCenter[1], -quadCenter[2]);
+      renderer->AddActor(texturedQuad);
+
+      // Single object has no name => output file names as before
+      SceneInstance instance;
+      instance.actor = texturedQuad;
+      instance.lod = NULL;
+      if (lodLevels > 1) {
+         LODMesh &lod = lodMeshes[command.GetValueAsString("model", "file")];
+         if (BuildLODMesh(reader->GetOutput(), command.GetValueAsString("model", "file"),
+                          lodLevels, lodCacheDir, lod)) {
+            return EXIT_FAILURE;
+         }
+         instance.lod = &lod;
+      }
+      instances.push_back(instance);
+   } else {
+      cerr << "Either --model or --scene must be given!" << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   // Construct and store the bounding box vertex coordinates (world coordinates)
+   // for every instance
+   for (size_t insti = 0; insti < instances.size(); insti++) {
+      double instBounds[6];
+      instances[insti].actor->GetBounds(instBounds);
+      BoundsToBBox(instBounds, instances[insti].bbox);
+      std::string instBBoxFile = command.GetValueAsString("bboutput", "file");
+      if (!instances[insti].name.empty())
+         instBBoxFile = AddPostDefToFilename(instBBoxFile, ("_" + instances[insti].name).c_str());
+      WriteBBox(instances[insti].bbox, AddPostDefToFilename(instBBoxFile, "_vtk_world"));
+   }
+
+   // Bounds of everything (the single object or the whole scene)
+   double bounds[6];
+   renderer->ComputeVisiblePropBounds(bounds);
+
+   // Background
    renderer->SetBackground(command.GetValueAsFloat("bgcolour", "r"),
                            command.GetValueAsFloat("bgcolour", "g"),
                            command.GetValueAsFloat("bgcolour", "b"));
@@ -174,6 +216,20 @@ int main ( int argc, char *argv[] ) {
       vtkSmartPointer<vtkPNGWriter>::New();
    pNGWriter->SetInputConnection(imageFilter->GetOutputPort());
 
+   // Or publish the frames to a shared memory ring (see frame_ring.h)
+   FrameRing streamRing;
+   FrameRing *stream = NULL;
+   if (command.GetOptionWasSet("stream_output")) {
+      if (FrameRingCreate(streamRing, command.GetValueAsString("stream_output", "name"),
+                          command.GetValueAsInt("stream_slots", "slots"),
+                          command.GetValueAsInt("image_size", "width"),
+                          command.GetValueAsInt("image_size", "height"), 3,
+                          command.GetValueAsInt("stream_timeout", "seconds"))) {
+         return EXIT_FAILURE;
+      }
+      stream = &streamRing;
+   }
+
    // Do the camera
    vtkCamera *camera = vtkCamera::New();
    //vtkCamera *camera = renderer->MakeCamera(); something weird happens to units with this
@@ -182,14 +238,21 @@ int main ( int argc, char *argv[] ) {
    renderer->SetActiveCamera(camera);
    renderer->ResetCamera();
 
-   // Set the camera position on the neg. z axis (pointing to the origin)
+   // Set the camera position on the neg. z axis (pointing to the origin,
+   // ResetCamera() points to the bounds centre which is not the origin in
+   // the scene mode)
+   camera->SetFocalPoint(0, 0, 0);
    double camPos[3];
    camera->GetPosition(camPos);
    if (command.GetValueAsFloat("camera_distance", "distance") == -1) {
-      // Set position based on the bounding box dimensions (note that bb now in the origin)
-      double bbDiagonal = sqrt((bounds[1] - bounds[0]) * (bounds[1] - bounds[0]) +
-                               (bounds[3] - bounds[2]) * (bounds[3] - bounds[2]) +
-                               (bounds[5] - bounds[4]) * (bounds[5] - bounds[4]));
+      // Set position based on the bounding box extent around the origin
+      // (the model is centred, scene instances can be anywhere)
+      double bbHalfSize[3];
+      for (int i = 0; i < 3; i++)
+         bbHalfSize[i] = std::max(fabs(bounds[2*i]), fabs(bounds[2*i + 1]));
+      double bbDiagonal = 2 * sqrt(bbHalfSize[0] * bbHalfSize[0] +
+                                   bbHalfSize[1] * bbHalfSize[1] +
+                                   bbHalfSize[2] * bbHalfSize[2]);
       // Put camera to negative z-axis (compatibility with CoViS and OpenCV coord. systems)
       // minimum distance to fit the diagonal + 10%
       camera->SetPosition(0, 0, -1.1*bbDiagonal / 2 / tan(camera->GetViewAngle()*M_PI / 180 / 2));
@@ -222,12 +285,17 @@ int main ( int argc, char *argv[] ) {
 
    // view mode 1 (frontal stereo)
    if (command.GetValueAsInt("view_mode", "mode") == 1) {
-      DisplayAndStoreStereo(renderer, pNGWriter,
-                            imageFilter,
-                            command.GetValueAsFloat("stereo_baseline", "baseline"),
-                            command.GetValueAsString("cam_mat_output", "file"),
-                            command.GetValueAsString("cam_img_output", "file"),
-                            bbox, command.GetValueAsString("bboutput", "file"));
+      if (DisplayAndStoreStereo(renderer, pNGWriter,
+                                imageFilter,
+                                command.GetValueAsFloat("stereo_baseline", "baseline"),
+                                command.GetValueAsString("cam_mat_output", "file"),
+                                command.GetValueAsString("cam_img_output", "file"),
+                                instances, command.GetValueAsString("bboutput", "file"),
+                                command.GetValueAsFloat("lod_pixels_per_triangle", "pixels"),
+                                stream)) {
+         FrameRingClose(*stream, true);
+         return EXIT_FAILURE;
+      }
    } // end of frontal stereo mode
 
    // view mode 2 (elevation/azimuth/zoom) - NOTE: zoom not tested
@@ -291,11 +359,16 @@ int main ( int argc, char *argv[] ) {
                iterCam = AddPostDefToFilename(command.GetValueAsString("cam_mat_output", "file"), iterStr);
                iterBbox = AddPostDefToFilename(command.GetValueAsString("bboutput", "file"), iterStr);
 
-               DisplayAndStoreStereo(renderer, pNGWriter,
-                                     imageFilter,
-                                     command.GetValueAsFloat("stereo_baseline", "baseline"),
-                                     iterCam, iterImg,
-                                     bbox, iterBbox);
+               if (DisplayAndStoreStereo(renderer, pNGWriter,
+                                         imageFilter,
+                                         command.GetValueAsFloat("stereo_baseline", "baseline"),
+                                         iterCam, iterImg,
+                                         instances, iterBbox,
+                                         command.GetValueAsFloat("lod_pixels_per_triangle", "pixels"),
+                                         stream)) {
+                  FrameRingClose(*stream, true);
+                  return EXIT_FAILURE;
+               }
 
                // Reset position and zoom to original for next values to be consistent
                camera->Zoom(1 / zoom[dind]);
@@ -308,19 +381,27 @@ int main ( int argc, char *argv[] ) {
       }
    } // end of view mode 2 (elevation/azimuth/zoom)
 
+   if (stream != NULL) {
+      FrameRingFinish(*stream);
+      FrameRingClose(*stream);
+   }
+
    return EXIT_SUCCESS;
 }
 
 /**
  * @brief Displays and stores left and right stereo images and stores their camera
- *        matrices
+ *        matrices. Returns non-zero if the stream consumer stopped reading.
  **/
-void DisplayAndStoreStereo(vtkRenderer *renderer, vtkPNGWriter *pNGWriter,
-                           vtkWindowToImageFilter *imageFilter,
-                           const double baseLine,
-                           const std::string &cam_mat_file,
-                           const std::string &cam_img_file,
-                           const double bbox[][8], const std::string &bbox_file) {
+int DisplayAndStoreStereo(vtkRenderer *renderer, vtkPNGWriter *pNGWriter,
+                          vtkWindowToImageFilter *imageFilter,
+                          const double baseLine,
+                          const std::string &cam_mat_file,
+                          const std::string &cam_img_file,
+                          const std::vector<SceneInstance> &instances,
+                          const std::string &bbox_file,
+                          const double lodPixelsPerTriangle,
+                          FrameRing *stream) {
 
    // For the baseline movement we need to solve the world direction of the camera x-axis (kind of a hack)
    vtkCamera *camera = renderer->GetActiveCamera();
@@ -330,15 +411,11 @@ void DisplayAndStoreStereo(vtkRenderer *renderer, vtkPNGWriter *pNGWriter,
    camera->GetViewUp(cam_x_direction);
    camera->Roll(-90);
 
-   // Left view - show and write to file
+   // Left camera position
    vtkTransform *tr = vtkTransform::New();
    tr->Translate(-cam_x_direction[0]*baseLine / 2, -cam_x_direction[1]*baseLine / 2, -cam_x_direction[2]*baseLine / 2);
    renderer->GetActiveCamera()->ApplyTransform(tr);
    renderer->ResetCameraClippingRange();
-   renderer->GetRenderWindow()->Render();
-   imageFilter->Modified(); // kludge as this filter sucks
-   pNGWriter->SetFileName(AddPostDefToFilename(cam_img_file, "_left").data());
-   pNGWriter->Write();
 
    // Construct and store camera matrices
    double K_l[3][3]; // intrinsic camera matrix (ref. [2])
@@ -352,29 +429,44 @@ void DisplayAndStoreStereo(vtkRenderer *renderer, vtkPNGWriter *pNGWriter,
    // Compute and store bounding box coordinates for this view
    // Can be moved to the display coordinates by the intrinsic matrix K and by noting
    // that the origin of the camera frame is bottom right and Z pointing toward the object
-   vtkTransform *camViewTransform = renderer->GetActiveCamera()->GetViewTransformObject();
-   double bbox_view[3][8];
-   double bbin[3], bbout[3];
-   for (int bbi = 0; bbi < 8; bbi++) {
-      bbin[0] = bbox[0][bbi];
-      bbin[1] = bbox[1][bbi];
-      bbin[2] = bbox[2][bbi];
-      camViewTransform->TransformPoint(bbin, bbout);
-      bbox_view[0][bbi] = bbout[0];
-      bbox_view[1][bbi] = bbout[1];
-      bbox_view[2][bbi] = bbout[2];
+   const CamK viewK = CamKFromViewAngle(sz, fov); // K_l as a value
+   CamR viewR;
+   CamT viewT;
+   CamRtFromMatrix4x4(renderer->GetActiveCamera()->GetViewTransformMatrix()->Element, viewR, viewT);
+   for (size_t insti = 0; insti < instances.size(); insti++) {
+      double bbox_view[3][8];
+      CamTransformPoints(viewR, viewT,
+                         instances[insti].bbox[0], instances[insti].bbox[1], instances[insti].bbox[2], 8,
+                         bbox_view[0], bbox_view[1], bbox_view[2]);
+      std::string instBBoxFile = bbox_file;
+      if (!instances[insti].name.empty())
+         instBBoxFile = AddPostDefToFilename(instBBoxFile, ("_" + instances[insti].name).c_str());
+      WriteBBox(bbox_view, AddPostDefToFilename(instBBoxFile, "_vtk_left_camera_frame"));
+
+      // Mesh level by the projected size in the left view (the same level is
+      // used for the right view to keep the pair consistent)
+      if (instances[insti].lod != NULL) {
+         int level = SelectLODLevel(*instances[insti].lod, ProjectedBBoxArea(bbox_view, viewK),
+                                    lodPixelsPerTriangle);
+         instances[insti].actor->SetMapper(instances[insti].lod->mappers[level]);
+      }
+   }
+
+   // Left view - show and write to file (or to the stream slot, waits if
+   // the consumer lags)
+   FrameRingSlot *slot = NULL;
+   renderer->GetRenderWindow()->Render();
+   imageFilter->Modified(); // kludge as this filter sucks
+   if (stream != NULL) {
+      slot = FrameRingAcquireWrite(*stream);
+      if (slot == NULL) {
+         return -1; // consumer missing or dead
+      }
+      CopyFrameToSlot(imageFilter, *stream, slot, FrameRingLeftPixels(slot));
+   } else {
+      pNGWriter->SetFileName(AddPostDefToFilename(cam_img_file, "_left").data());
+      pNGWriter->Write();
    }
-   std::ofstream bboxFile;
-   bboxFile.open(AddPostDefToFilename(bbox_file, "_vtk_left_camera_frame").data());
-   bboxFile << bbox_view[0][0] << " " << bbox_view[1][0] << " " << bbox_view[2][0] << std::endl;
-   bboxFile << bbox_view[0][1] << " " << bbox_view[1][1] << " " << bbox_view[2][1] << std::endl;
-   bboxFile << bbox_view[0][2] << " " << bbox_view[1][2] << " " << bbox_view[2][2] << std::endl;
-   bboxFile << bbox_view[0][3] << " " << bbox_view[1][3] << " " << bbox_view[2][3] << std::endl;
-   bboxFile << bbox_view[0][4] << " " << bbox_view[1][4] << " " << bbox_view[2][4] << std::endl;
-   bboxFile << bbox_view[0][5] << " " << bbox_view[1][5] << " " << bbox_view[2][5] << std::endl;
-   bboxFile << bbox_view[0][6] << " " << bbox_view[1][6] << " " << bbox_view[2][6] << std::endl;
-   bboxFile << bbox_view[0][7] << " " << bbox_view[1][7] << " " << bbox_view[2][7] << std::endl;
-   bboxFile.close();
 
    /* try 1
    double bbox_view[3][8];
@@ -402,8 +494,12 @@ void DisplayAndStoreStereo(vtkRenderer *renderer, vtkPNGWriter *pNGWriter,
    renderer->ResetCameraClippingRange();
    renderer->GetRenderWindow()->Render();
    imageFilter->Modified(); // kludge as this filter sucks
-   pNGWriter->SetFileName(AddPostDefToFilename(cam_img_file, "_right").data());
-   pNGWriter->Write();
+   if (stream != NULL) {
+      CopyFrameToSlot(imageFilter, *stream, slot, FrameRingRightPixels(slot));
+   } else {
+      pNGWriter->SetFileName(AddPostDefToFilename(cam_img_file, "_right").data());
+      pNGWriter->Write();
+   }
 
    // Construct and store camera matrices
    double K_r[3][3]; // intrinsic camera matrix (ref. [2])
@@ -412,16 +508,193 @@ void DisplayAndStoreStereo(vtkRenderer *renderer, vtkPNGWriter *pNGWriter,
    double k_r[4]; // lens distortion parameters
    CanonicStereoCameraMatrix_CoViS(sz, fov, baseLine, 0, K_r, R_r, t_r, k_r);
 
-   // Save camera calibration information in OpenCV format
-   SaveStereoCalibrationOpenCV(sz, sz, K_l, K_r, R_l, R_r, t_l, t_r, k_l, k_r,
-                               AddPostDefToFilename(cam_mat_file, "_CoViS_canonic"));
+   // Save camera calibration information in OpenCV format (or publish the
+   // stream frame with its calibration)
+   if (stream != NULL) {
+      memcpy(slot->K_l, K_l, sizeof(slot->K_l));
+      memcpy(slot->R_l, R_l, sizeof(slot->R_l));
+      memcpy(slot->t_l, t_l, sizeof(slot->t_l));
+      memcpy(slot->K_r, K_r, sizeof(slot->K_r));
+      memcpy(slot->R_r, R_r, sizeof(slot->R_r));
+      memcpy(slot->t_r, t_r, sizeof(slot->t_r));
+      strncpy(slot->name, cam_img_file.c_str(), FRAME_RING_NAME_LENGTH - 1);
+      slot->name[FRAME_RING_NAME_LENGTH - 1] = 0;
+      FrameRingCommitWrite(*stream);
+   } else {
+      SaveStereoCalibrationOpenCV(sz, sz, K_l, K_r, R_l, R_r, t_l, t_r, k_l, k_r,
+                                  AddPostDefToFilename(cam_mat_file, "_CoViS_canonic"));
+   }
 
    // Return camera to the original position (needed for the elevation/azimuth loop)
    tr->Identity();
    tr->Translate(-cam_x_direction[0]*baseLine / 2, -cam_x_direction[1]*baseLine / 2, -cam_x_direction[2]*baseLine / 2);
    renderer->GetActiveCamera()->ApplyTransform(tr);
    renderer->ResetCameraClippingRange();
-   return;
+   return 0;
+}
+
+/**
+ * @brief Copies the rendered image (RGB, bottom-up rows) to a stream slot
+ *        and sets the slot image size (both views share the size).
+ **/
+void CopyFrameToSlot(vtkWindowToImageFilter *imageFilter, const FrameRing &ring,
+                     FrameRingSlot *slot, unsigned char *pixels) {
+   imageFilter->Update();
+   vtkImageData *img = imageFilter->GetOutput();
+   int dims[3];
+   img->GetDimensions(dims);
+   slot->width = dims[0];
+   slot->height = dims[1];
+   slot->channels = img->GetNumberOfScalarComponents();
+   slot->originBottomLeft = 1;
+   if ((unsigned)slot->width > ring.header->maxWidth ||
+       (unsigned)slot->height > ring.header->maxHeight ||
+       (unsigned)slot->channels > ring.header->channels) {
+      cerr << "Rendered image " << slot->width << "x" << slot->height
+           << " does not fit to the stream slot!" << std::endl;
+      slot->width = slot->height = 0; // empty frame rather than overflow
+      return;
+   }
+   memcpy(pixels, img->GetScalarPointer(), (size_t)dims[0] * dims[1] * slot->channels);
+}
+
+/**
+ * @brief Reads a scene description and adds one actor per instance to the
+ *        renderer. Every line of the scene file is (# starts a comment):
+ *
+ *  <obj_file> <png_file> <inst_name> <rot_x> <rot_y> <rot_z> <pos_x> <pos_y> <pos_z>
+ *
+ *        The rotations are as in --objorientation and the object is first
+ *        centred by its bounding box and then moved to the given position.
+ *        Use "-" as <png_file> to render shape only. Every OBJ and PNG file
+ *        is read only once and repeated instances share the same mapper and
+ *        texture, i.e. loading and GPU upload scale with the unique assets.
+ *        If lodLevels > 1, the mesh levels are built once per model as well.
+ **/
+int LoadScene(const std::string &sceneFile, vtkRenderer *renderer,
+              const int lodLevels, const std::string &lodCacheDir,
+              std::map<std::string, LODMesh> &lodMeshes,
+              std::vector<SceneInstance> &instances) {
+   std::ifstream fd(sceneFile.data());
+   if (!fd.is_open()) {
+      cerr << "Cannot open scene file " << sceneFile << std::endl;
+      return -1;
+   }
+
+   std::map<std::string, vtkSmartPointer<vtkPolyDataMapper> > mapperCache;
+   std::map<std::string, vtkSmartPointer<vtkTexture> > textureCache;
+   std::string line;
+   int lineNum = 0;
+   while (std::getline(fd, line)) {
+      lineNum++;
+      size_t firstChar = line.find_first_not_of(" \t\r");
+      if (firstChar == std::string::npos || line[firstChar] == '#')
+         continue; // empty or comment line
+
+      std::istringstream lineStream(line);
+      std::string modelFile, textureFile;
+      SceneInstance instance;
+      double orientation[3], position[3];
+      if (!(lineStream >> modelFile >> textureFile >> instance.name
+            >> orientation[0] >> orientation[1] >> orientation[2]
+            >> position[0] >> position[1] >> position[2])) {
+         cerr << "Invalid scene line " << lineNum << " in " << sceneFile << std::endl;
+         return -1;
+      }
+
+      // Shared mesh
+      if (mapperCache.find(modelFile) == mapperCache.end()) {
+         vtkSmartPointer<vtkOBJReader> reader =
+            vtkSmartPointer<vtkOBJReader>::New();
+         reader->SetFileName(modelFile.c_str());
+         reader->Update();
+         vtkSmartPointer<vtkPolyDataMapper> mapper =
+            vtkSmartPointer<vtkPolyDataMapper>::New();
+         mapper->SetInputConnection(reader->GetOutputPort());
+         mapperCache[modelFile] = mapper;
+         if (lodLevels > 1 &&
+             BuildLODMesh(reader->GetOutput(), modelFile, lodLevels, lodCacheDir,
+                          lodMeshes[modelFile])) {
+            return -1;
+         }
+      }
+
+      // Shared texture
+      if (textureFile != "-" && textureCache.find(textureFile) == textureCache.end()) {
+         vtkSmartPointer<vtkPNGReader> pNGReader =
+            vtkSmartPointer<vtkPNGReader>::New();
+         pNGReader->SetFileName(textureFile.c_str());
+         vtkSmartPointer<vtkTexture> texture =
+            vtkSmartPointer<vtkTexture>::New();
+         texture->SetInput(pNGReader->GetOutput());
+         textureCache[textureFile] = texture;
+      }
+
+      instance.actor = vtkSmartPointer<vtkActor>::New();
+      instance.actor->SetMapper(mapperCache[modelFile]);
+      instance.lod = (lodLevels > 1) ? &lodMeshes[modelFile] : NULL;
+      if (textureFile != "-")
+         instance.actor->SetTexture(textureCache[textureFile]);
+      instance.actor->SetOrientation(orientation[0], orientation[1], orientation[2]);
+      double *instCenter = instance.actor->GetCenter();
+      instance.actor->SetPosition(position[0] - instCenter[0],
+                                  position[1] - instCenter[1],
+                                  position[2] - instCenter[2]);
+      renderer->AddActor(instance.actor);
+      instances.push_back(instance);
+   }
+   fd.close();
+
+   if (instances.empty()) {
+      cerr << "No instances in scene file " << sceneFile << std::endl;
+      return -1;
+   }
+   cout << "[NOTE] Scene of " << instances.size() << " instances ("
+        << mapperCache.size() << " unique models, " << textureCache.size()
+        << " unique textures)." << std::endl;
+   return 0;
+}
+
+/**
+ * @brief Constructs the 8 bounding box vertices from the VTK bounds
+ *        (xmin,xmax,ymin,ymax,zmin,zmax).
+ **/
+void BoundsToBBox(const double bounds[], double bbox[][8]) {
+   bbox[0][0] = bounds[0];
+   bbox[1][0] = bounds[2];
+   bbox[2][0] = bounds[4]; //(xmin,ymin,zmin)
+   bbox[0][1] = bounds[1];
+   bbox[1][1] = bounds[2];
+   bbox[2][1] = bounds[4]; //(xmax,ymin,zmin)
+   bbox[0][2] = bounds[0];
+   bbox[1][2] = bounds[3];
+   bbox[2][2] = bounds[4]; //(xmin,ymax,zmin)
+   bbox[0][3] = bounds[0];
+   bbox[1][3] = bounds[2];
+   bbox[2][3] = bounds[5]; //(xmin,ymin,zmax)
+   bbox[0][4] = bounds[1];
+   bbox[1][4] = bounds[3];
+   bbox[2][4] = bounds[4]; //(xmax,ymax,zmin)
+   bbox[0][5] = bounds[1];
+   bbox[1][5] = bounds[2];
+   bbox[2][5] = bounds[5]; //(xmax,ymin,zmax)
+   bbox[0][6] = bounds[0];
+   bbox[1][6] = bounds[3];
+   bbox[2][6] = bounds[5]; //(xmin,ymax,zmax)
+   bbox[0][7] = bounds[1];
+   bbox[1][7] = bounds[3];
+   bbox[2][7] = bounds[5]; //(xmax,ymax,zmax)
+}
+
+/**
+ * @brief Writes the 8 bounding box vertices, one vertex per line.
+ **/
+void WriteBBox(const double bbox[][8], const std::string &bbox_file) {
+   std::ofstream bBFile;
+   bBFile.open(bbox_file.data());
+   for (int bbi = 0; bbi < 8; bbi++)
+      bBFile << bbox[0][bbi] << " " << bbox[1][bbi] << " " << bbox[2][bbi] << std::endl;
+   bBFile.close();
 }
 
 /**
@@ -433,35 +706,16 @@ void DisplayAndStoreStereo(vtkRenderer *renderer, vtkPNGWriter *pNGWriter,
  *        for the left view is positive (neg. of that given)
  **/
 void CanonicStereoCameraMatrix_CoViS(const int sz[], const double fov, const double baseLine, const short leftView, double K[][3], double R[][3], double t[], double k[]) {
-   // compute alpha_x and alpha_y (focal lengths in terms of pixels, see eq. (6.9) in ref. [2])
-   int szx = sz[0];
-   int szy = sz[1];
-   const double fx = sz[0] / 2 / std::tan(fov * M_PI / 2 / 180.0);
-   const double fy = sz[1] / 2 / std::tan(fov * M_PI / 2 / 180.0);
-   //    fx  0 x_0
-   //K =  0 fy y_0
-   //     0  0   1
-   K[0][0] = fx;
-   K[0][1] = 0; // skew is 0
-   K[0][2] = sz[0] / 2; // principal point x_0 in pixels
-   K[1][0] = 0;
-   K[1][1] = fy;
-   K[1][2] = sz[1] / 2; // principal point y_0 in pixels
-   K[2][0] = 0;
-   K[2][1] = 0;
-   K[2][2] = 1;
-   //     1 0 0
-   // R = 0 1 0
-   //     0 0 1
-   R[0][0] = 1;
-   R[0][1] = 0;
-   R[0][2] = 0;
-   R[1][0] = 0;
-   R[1][1] = 1;
-   R[1][2] = 0;
-   R[2][0] = 0;
-   R[2][1] = 0;
-   R[2][2] = 1;
+   // alpha_x and alpha_y (focal lengths in terms of pixels, see eq. (6.9) in
+   // ref. [2]), principal point in the image centre and no skew
+   const CamK camK = CamKFromViewAngle(sz, fov);
+   const CamR camR = CamRIdentity();
+   for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+         K[i][j] = camK.m[i][j];
+         R[i][j] = camR.m[i][j];
+      }
+   }
    //
    // t = [baseline/2 0 0];
    if (leftView == 1)
@@ -587,77 +841,54 @@ void saveCameraMatrixCanonicOpenCV(vtkRenderer *renderer, double camMatr[][4], d
  * Note: vtk image origin is at the bottom left corner
  **/
 void ConstructCameraMatrixVTK(vtkRenderer *renderer, double camMatr[][4]) {
-   double *dispPoint;
-   double *viewport;
-
-   int sizex, sizey;
-   int *size;
-
    // Window (image) size
-   size = renderer->GetRenderWindow()->GetSize();
-   sizex = size[0];
-   sizey = size[1];
+   int *size = renderer->GetRenderWindow()->GetSize();
+   const int sizex = size[0];
+   const int sizey = size[1];
 
-   // World to view transformation vPw
-   viewport = renderer->GetViewport();
-   vtkSmartPointer<vtkMatrix4x4> vPw =
+   // World to view transformation vPw (owned by the camera)
+   double *viewport = renderer->GetViewport();
+   vtkMatrix4x4 *vPw =
       renderer->GetActiveCamera()->
       GetCompositePerspectiveTransformMatrix (renderer->GetTiledAspectRatio(), 0, 1);
 
-   // View to camera (display) transformation constructed in a way that its
-   // multiplication with vPw forms the final result, i.e. cPw = cPv*vPw
-   // see vtkRenderer::ViewToDisplay() for details (and do some matr. algebra)
-   vtkSmartPointer<vtkMatrix4x4> cPv = vtkSmartPointer<vtkMatrix4x4>::New();
-
-   cPv->SetElement(0, 0, sizex*(viewport[2] - viewport[0]) / 2);
-   cPv->SetElement(0, 1, 0);
-   cPv->SetElement(0, 2, 0);
-   cPv->SetElement(0, 3, sizex*(viewport[2] + viewport[0]) / 2);
-
-   cPv->SetElement(1, 0, 0);
-   cPv->SetElement(1, 1, sizey*(viewport[3] - viewport[1]) / 2);
-   cPv->SetElement(1, 2, 0);
-   cPv->SetElement(1, 3, sizey*(viewport[3] + viewport[1]) / 2);
-
-   cPv->SetElement(2, 0, 0);
-   cPv->SetElement(2, 1, 0);
-   cPv->SetElement(2, 2, 0);
-   cPv->SetElement(2, 3, 1);
-
-   cPv->SetElement(3, 0, 0);
-   cPv->SetElement(3, 1, 0);
-   cPv->SetElement(3, 2, 0);
-   cPv->SetElement(3, 3, 0);
-
-   // Form the final matrix
-   vtkSmartPointer<vtkMatrix4x4> cPw = vtkSmartPointer<vtkMatrix4x4>::New();
-   vtkMatrix4x4::Multiply4x4(cPv, vPw, cPw);
-
-   // Store, not that the result matrix is actually 3x4
-   camMatr[0][0] = cPw->GetElement(0, 0);
-   camMatr[0][1] = cPw->GetElement(0, 1);
-   camMatr[0][2] = cPw->GetElement(0, 2);
-   camMatr[0][3] = cPw->GetElement(0, 3);
-   camMatr[1][0] = cPw->GetElement(1, 0);
-   camMatr[1][1] = cPw->GetElement(1, 1);
-   camMatr[1][2] = cPw->GetElement(1, 2);
-   camMatr[1][3] = cPw->GetElement(1, 3);
-   camMatr[2][0] = cPw->GetElement(2, 0);
-   camMatr[2][1] = cPw->GetElement(2, 1);
-   camMatr[2][2] = cPw->GetElement(2, 2);
-   camMatr[2][3] = cPw->GetElement(2, 3);
+   // View to camera (display) transformation cPv such that cPw = cPv*vPw
+   // (see vtkRenderer::ViewToDisplay() for details and do some matr. algebra)
+   // is sparse
+   //        sx  0 0 ox
+   // cPv =   0 sy 0 oy
+   //         0  0 0  1
+   const double sx = sizex*(viewport[2] - viewport[0]) / 2;
+   const double ox = sizex*(viewport[2] + viewport[0]) / 2;
+   const double sy = sizey*(viewport[3] - viewport[1]) / 2;
+   const double oy = sizey*(viewport[3] + viewport[1]) / 2;
+
+   // Form and store the final matrix (actually 3x4)
+   for (int j = 0; j < 4; j++) {
+      camMatr[0][j] = sx * vPw->Element[0][j] + ox * vPw->Element[3][j];
+      camMatr[1][j] = sy * vPw->Element[1][j] + oy * vPw->Element[3][j];
+      camMatr[2][j] = vPw->Element[3][j];
+   }
 }
 
 /**
  * @brief Forms a 3x4 camera matrix compatible with CoViS coordinates and
- * definitions. THIS HAS NOT BEEN IMPLEMENTED - but it should be very similar
- * to ConstructCameraMatrixVTK() - only display origin should be fixed and
- * maybe the directions of axes.... I will not implement this until really
- * need it...
+ * definitions, i.e. P = K[R|t] where K is as in CanonicStereoCameraMatrix_CoViS()
+ * and [R|t] is the VTK view transformation turned to the CoViS camera frame
+ * (see camera_geometry.h).
  * Note: CoViS origin is at the upper corner
  **/
 void ConstructCameraMatrixCoViS(vtkRenderer *renderer, double camMatr[][4]) {
-   cerr << "ConstructCameraMatrixCoViS IS NOT IMPLEMENTED...AAARGH!";
+   CamK K = CamKFromViewAngle(renderer->GetRenderWindow()->GetSize(),
+                              renderer->GetActiveCamera()->GetViewAngle());
+   CamR R;
+   CamT t;
+   CamRtFromMatrix4x4(renderer->GetActiveCamera()->GetViewTransformMatrix()->Element, R, t);
+   CamConvertRt(CAM_VTK, CAM_COVIS, R, t);
+   CamP P = CamComposeP(K, R, t);
+   for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 4; j++)
+         camMatr[i][j] = P.m[i][j];
 }
 
 /**
@@ -703,7 +934,7 @@ int MainParseCommandLine( vtkmetaio::MetaCommand& command,
    command.AddOptionField("debug_mode", "mode",
                           vtkmetaio::MetaCommand::INT, true, "0");
 
-   command.SetOption("model", "", true, "Model file (OBJ format supported).");
+   command.SetOption("model", "", false, "Model file (OBJ format supported). Required unless --scene given.");
    command.SetOptionLongTag("model", "model");
    command.AddOptionField("model", "file", vtkmetaio::MetaCommand::STRING, true);
 
@@ -711,6 +942,10 @@ int MainParseCommandLine( vtkmetaio::MetaCommand& command,
    command.SetOptionLongTag("texture", "texture");
    command.AddOptionField("texture", "file", vtkmetaio::MetaCommand::STRING, true);
 
+   command.SetOption("scene", "", false, "Scene file of many object instances (replaces --model and --texture). Each line: <obj_file> <png_file or -> <inst_name> <rot_x> <rot_y> <rot_z> <pos_x> <pos_y> <pos_z>. Bounding boxes are written per instance (<bboutput>_<inst_name>_*).");
+   command.SetOptionLongTag("scene", "scene");
+   command.AddOptionField("scene", "file", vtkmetaio::MetaCommand::STRING, true);
+
    command.SetOption("bboutput", "", false, "File where the bounding box written.");
    command.SetOptionLongTag("bboutput", "bboutput");
    command.AddOptionField("bboutput", "file", vtkmetaio::MetaCommand::STRING, true, "render_3d_object_bbox.dat");
@@ -771,6 +1006,34 @@ int MainParseCommandLine( vtkmetaio::MetaCommand& command,
    command.AddOptionField("stereo_baseline", "baseline",
                           vtkmetaio::MetaCommand::FLOAT, true, "50");
 
+   command.SetOption("lod_levels", "", false, "Number of mesh levels of detail (1: full mesh only). Every level has half of the triangles of the previous one and they are cached as <model>_lod<level>.vtp files.");
+   command.SetOptionLongTag("lod_levels", "lod_levels");
+   command.AddOptionField("lod_levels", "levels",
+                          vtkmetaio::MetaCommand::INT, true, "1");
+
+   command.SetOption("lod_pixels_per_triangle", "", false, "The coarsest mesh level whose triangles are at most this size (in pixels) in the left view is rendered.");
+   command.SetOptionLongTag("lod_pixels_per_triangle", "lod_pixels_per_triangle");
+   command.AddOptionField("lod_pixels_per_triangle", "pixels",
+                          vtkmetaio::MetaCommand::FLOAT, true, "2.0");
+
+   command.SetOption("lod_cache_dir", "", false, "Directory for the cached mesh levels (default: the model directory).");
+   command.SetOptionLongTag("lod_cache_dir", "lod_cache_dir");
+   command.AddOptionField("lod_cache_dir", "dir", vtkmetaio::MetaCommand::STRING, true);
+
+   command.SetOption("stream_output", "", false, "Publish the stereo frames and their camera matrices to this POSIX shared memory ring (see frame_ring.h) instead of writing PNG and calibration files.");
+   command.SetOptionLongTag("stream_output", "stream_output");
+   command.AddOptionField("stream_output", "name", vtkmetaio::MetaCommand::STRING, true);
+
+   command.SetOption("stream_slots", "", false, "Number of frames in the shared memory ring (rendering waits when all are unread).");
+   command.SetOptionLongTag("stream_slots", "stream_slots");
+   command.AddOptionField("stream_slots", "slots",
+                          vtkmetaio::MetaCommand::INT, true, "4");
+
+   command.SetOption("stream_timeout", "", false, "Seconds to wait for the consumer to free a slot before giving up (0 waits forever).");
+   command.SetOptionLongTag("stream_timeout", "stream_timeout");
+   command.AddOptionField("stream_timeout", "seconds",
+                          vtkmetaio::MetaCommand::INT, true, "60");
+
    command.SetOption("elevation", "", false, "Camera elevation in degrees (view mode 2) (upto 5 values, use \"nan\" to omit).");
    command.SetOptionLongTag("elevation", "elevation");
    command.AddOptionField("elevation", "val1", vtkmetaio::MetaCommand::FLOAT, false, "-10.0");